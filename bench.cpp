@@ -0,0 +1,631 @@
+/**
+ * ASTEROIDS BENCH
+ * Microbenchmarks de Quadtree y MiVector y frames completos de World con escenas de 100 a 100k
+ * asteroides y balas (uniformes y en grupos). Escribe los resultados en JSON para comparar commits.
+ * Cada escena se repite hasta --frames veces o ~2 s, lo que pase primero, y se reporta la mejor.
+ * Con --autotune graba escenas (cada llamada a la broadphase) y las reproduce sobre una grilla de
+ * QuadtreeT<capacidad, profundidad, coordenada>, reportando la configuracion mas rapida por tamanio.
+ * Con --threads N los frames usan el sistema de tareas (0 = todos los nucleos).
+ * Uso: ./bench [--out archivo.json] [--max-n N] [--frames N] [--seed N] [--threads N] [--max-pairs N] [--autotune]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "world.h"
+#include "snapshot.h"
+
+struct OpcionesBench {
+    const char* out = nullptr; //nullptr = stdout
+    int maxN = 100000;
+    int frames = 10; //repeticiones por escena
+    unsigned seed = 1;
+    bool autotune = false;
+    int threads = 1;
+    size_t maxPares = (size_t)1 << 26; //tope de pares por frame (~1 GB de lista); mas que eso se reporta
+};
+
+OpcionesBench LeerOpciones(int argc, char** argv) {
+    OpcionesBench op;
+    for (int i = 1; i < argc; i++) {
+        bool hayValor = (i + 1 < argc);
+        if (!strcmp(argv[i], "--out") && hayValor) op.out = argv[++i];
+        else if (!strcmp(argv[i], "--max-n") && hayValor) op.maxN = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--frames") && hayValor) op.frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hayValor) op.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--threads") && hayValor) op.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--max-pairs") && hayValor) op.maxPares = (size_t)strtoull(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--autotune")) op.autotune = true;
+        else {
+            fprintf(stderr, "uso: %s [--out archivo.json] [--max-n N] [--frames N] [--seed N] [--threads N] [--max-pairs N] [--autotune]\n", argv[0]);
+            exit(1);
+        }
+    }
+    return op;
+}
+
+typedef std::chrono::steady_clock Reloj;
+
+static double SegundosDesde(Reloj::time_point t0) {
+    return std::chrono::duration<double>(Reloj::now() - t0).count();
+}
+
+//generador propio para armar las escenas (las formas de los asteroides salen de world.rng)
+struct Azar {
+    unsigned long long s;
+    explicit Azar(unsigned seed) : s(seed * 2654435761ull + 1) {}
+    unsigned siguiente() { s ^= s << 13; s ^= s >> 7; s ^= s << 17; return (unsigned)(s >> 32); }
+    float uniforme(float a, float b) { return a + (b - a) * (siguiente() / 4294967296.0f); }
+    float normal() { //Box-Muller
+        float u = uniforme(1e-6f, 1.0f), v = uniforme(0.0f, 1.0f);
+        return sqrtf(-2.0f * logf(u)) * cosf(2.0f * PI * v);
+    }
+};
+
+//Escena de prueba: 'uniforme' reparte por toda la pantalla; 'grupos' concentra todo en 8 manchas de ~30 px
+struct Distribucion {
+    bool grupos;
+    float cx[8], cy[8];
+
+    Distribucion(bool _grupos, Azar& azar) : grupos(_grupos) {
+        for (int k = 0; k < 8; k++) { cx[k] = azar.uniforme(60, SCREEN_WIDTH - 60); cy[k] = azar.uniforme(60, SCREEN_HEIGHT - 60); }
+    }
+    void punto(Azar& azar, float& x, float& y) const {
+        if (!grupos) { x = azar.uniforme(0, SCREEN_WIDTH); y = azar.uniforme(0, SCREEN_HEIGHT); return; }
+        int k = azar.siguiente() % 8;
+        x = std::min(std::max(cx[k] + azar.normal() * 30.0f, 0.0f), (float)SCREEN_WIDTH);
+        y = std::min(std::max(cy[k] + azar.normal() * 30.0f, 0.0f), (float)SCREEN_HEIGHT);
+    }
+};
+
+//Salida JSON: un arreglo plano de resultados, cada uno con su nombre y parametros
+class SalidaJSON {
+    FILE* f;
+    bool primero;
+public:
+    explicit SalidaJSON(FILE* _f) : f(_f), primero(true) { fprintf(f, "{\n  \"bench\": \"asteroids\",\n  \"simd\": \"%s\",\n  \"results\": [\n", SimdNombre()); }
+    void hilos(int n) { fprintf(f, "%s    {\"name\": \"threads\", \"n\": %d}", primero ? "" : ",\n", n); primero = false; }
+    ~SalidaJSON() { fprintf(f, "\n  ]\n}\n"); }
+
+    void micro(const char* nombre, int n, double nsPorOp, long long chequeo) {
+        fprintf(f, "%s    {\"name\": \"%s\", \"n\": %d, \"ns_per_op\": %.3f, \"check\": %lld}", primero ? "" : ",\n", nombre, n, nsPorOp, chequeo);
+        primero = false;
+    }
+    void frame(const char* broadphase, const char* dist, int n, double msFrame, double msSiguiente,
+               double pares, double tests, int nodos) {
+        fprintf(f, "%s    {\"name\": \"frame\", \"broadphase\": \"%s\", \"dist\": \"%s\", \"n\": %d, \"ms_per_frame\": %.4f, "
+                   "\"next_frame_ms\": %.4f, \"pairs\": %.0f, \"narrowphase_tests\": %.0f, \"nodes\": %d}",
+                primero ? "" : ",\n", broadphase, dist, n, msFrame, msSiguiente, pares, tests, nodos);
+        primero = false;
+    }
+    void autotune(const char* escena, int n, const char* config, double msPorFrame, bool mejor) {
+        fprintf(f, "%s    {\"name\": \"autotune\", \"scene\": \"%s\", \"n\": %d, \"config\": \"%s\", \"ms_per_frame\": %.4f, \"best\": %s}",
+                primero ? "" : ",\n", escena, n, config, msPorFrame, mejor ? "true" : "false");
+        primero = false;
+    }
+    void falla(const char* broadphase, const char* dist, int n, const char* error) { //la escena no se pudo correr
+        fprintf(f, "%s    {\"name\": \"frame\", \"broadphase\": \"%s\", \"dist\": \"%s\", \"n\": %d, \"error\": \"%s\"}",
+                primero ? "" : ",\n", broadphase, dist, n, error);
+        primero = false;
+    }
+};
+
+//Cada micro se repite hasta juntar ~50 ms y se reporta la mejor vuelta (la menos ruidosa)
+template <typename F>
+double MejorNs(F vuelta, int opsPorVuelta) {
+    double mejor = 1e30, total = 0;
+    for (int r = 0; r < 50 && (r < 3 || total < 0.05); r++) {
+        auto t0 = Reloj::now();
+        vuelta();
+        double s = SegundosDesde(t0);
+        total += s;
+        if (s < mejor) mejor = s;
+    }
+    return mejor * 1e9 / opsPorVuelta;
+}
+
+void BenchQuadtree(SalidaJSON& out, int n, Azar& azar) {
+    Rect pantalla = { 0, 0, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT };
+    MiVector<Rect> cajas;
+    cajas.reserve(n);
+    for (int i = 0; i < n; i++) {
+        float w = azar.uniforme(5, 60);
+        cajas.push_back({ azar.uniforme(0, SCREEN_WIDTH - w), azar.uniforme(0, SCREEN_HEIGHT - w), w, w });
+    }
+    Quadtree qt(0, pantalla);
+    qt.reservar(n);
+    Candidatos cand;
+    long long chequeo = 0;
+
+    double ns = MejorNs([&] {
+        qt.clear();
+        for (int i = 0; i < n; i++) qt.insert({ cajas[i], { TIPO_ASTEROIDE, (unsigned)i } });
+    }, n);
+    out.micro("quadtree_insert", n, ns, qt.nodeCount());
+
+    int consultas = std::min(n, 10000); //con el arbol lleno cada consulta es cara, se toma una muestra
+    ns = MejorNs([&] {
+        chequeo = 0;
+        for (int i = 0; i < consultas; i++) { cand.clear(); qt.retrieve(cand, cajas[i]); chequeo += cand.size(); }
+    }, consultas);
+    out.micro("quadtree_retrieve", n, ns, chequeo);
+
+    //lo mismo sin armar la lista: el visitante solo cuenta
+    ns = MejorNs([&] {
+        chequeo = 0;
+        for (int i = 0; i < consultas; i++) qt.visitar(cajas[i], [&](const BroadItem&) { chequeo++; return true; });
+    }, consultas);
+    out.micro("quadtree_query", n, ns, chequeo);
+
+    //con corte en el primero: "hay algo aca?"
+    ns = MejorNs([&] {
+        chequeo = 0;
+        for (int i = 0; i < consultas; i++) chequeo += qt.hayAlguno(cajas[i], TIPO_ASTEROIDE);
+    }, consultas);
+    out.micro("quadtree_any", n, ns, chequeo);
+
+    double nsClear = 1e30; //clear sobre un arbol lleno (el llenado no se cuenta)
+    for (int r = 0; r < 5; r++) {
+        for (int i = 0; i < n; i++) qt.insert({ cajas[i], { TIPO_ASTEROIDE, (unsigned)i } });
+        auto t0 = Reloj::now();
+        qt.clear();
+        nsClear = std::min(nsClear, SegundosDesde(t0) * 1e9);
+    }
+    out.micro("quadtree_clear", n, nsClear, qt.nodeCount());
+}
+
+void BenchMiVector(SalidaJSON& out, int n) {
+    MiVector<int> v;
+    long long chequeo = 0;
+
+    double ns = MejorNs([&] {
+        MiVector<int> nuevo; //sin reserve: incluye los crecimientos
+        for (int i = 0; i < n; i++) nuevo.push_back(i);
+        chequeo = (long long)nuevo.size();
+    }, n);
+    out.micro("mivector_push_back", n, ns, chequeo);
+
+    int borrar = std::min(n / 2, 1000); //erase ordenado es O(n) por llamada, se borran a lo mas 1000
+    ns = MejorNs([&] {
+        v.clear();
+        for (int i = 0; i < n; i++) v.push_back(i);
+        for (int k = 0; k < borrar; k++) v.erase(v.size() / 2);
+        chequeo = v[v.size() / 2];
+    }, borrar);
+    out.micro("mivector_erase", n, ns, chequeo);
+
+    ns = MejorNs([&] {
+        v.clear();
+        for (int i = 0; i < n; i++) v.push_back(i);
+        for (int k = 0; k < borrar; k++) v.erase_unordered(v.size() / 2);
+        chequeo = v[v.size() / 2];
+    }, borrar);
+    out.micro("mivector_erase_unordered", n, ns, chequeo);
+}
+
+//Kernels de simd.h contra su version escalar, con los mismos datos
+void BenchSimd(SalidaJSON& out, int n, Azar& azar) {
+    MiVector<float> pos, vel, margen;
+    for (int i = 0; i < n; i++) {
+        pos.push_back(azar.uniforme(-60, SCREEN_WIDTH + 60));
+        vel.push_back(azar.uniforme(-300, 300));
+        margen.push_back(azar.uniforme(20, 60));
+    }
+    double ns = MejorNs([&] { IntegrarEnvolverEscalar(pos.data(), vel.data(), margen.data(), 0, SCREEN_WIDTH, n, 1.0f / 60.0f); }, n);
+    out.micro("integrate_wrap_scalar", n, ns, (long long)pos[n / 2]);
+    ns = MejorNs([&] { IntegrarEnvolver(pos.data(), vel.data(), margen.data(), 0, SCREEN_WIDTH, n, 1.0f / 60.0f); }, n);
+    out.micro("integrate_wrap_simd", n, ns, (long long)pos[n / 2]);
+
+    //una bala contra lotes de 8 asteroides; n lotes con cajas al azar alrededor de la bala
+    MiVector<float> x, y, w;
+    MiVector<Rect> balas;
+    for (int i = 0; i < n * LOTE_AABB; i++) { x.push_back(azar.uniforme(0, 60)); y.push_back(azar.uniforme(0, 60)); w.push_back(azar.uniforme(5, 40)); }
+    for (int i = 0; i < n; i++) balas.push_back({ azar.uniforme(0, 60), azar.uniforme(0, 60), BULLET_SIZE, BULLET_SIZE });
+    long long chequeo = 0;
+    ns = MejorNs([&] {
+        chequeo = 0;
+        for (int i = 0; i < n; i++) {
+            int k = i * LOTE_AABB;
+            chequeo += CajaContraLoteEscalar(balas[i], &x[k], &y[k], &w[k], &w[k], LOTE_AABB);
+        }
+    }, n * LOTE_AABB);
+    out.micro("aabb_batch_scalar", n, ns, chequeo);
+    ns = MejorNs([&] {
+        chequeo = 0;
+        for (int i = 0; i < n; i++) {
+            int k = i * LOTE_AABB;
+            chequeo += CajaContraLote(balas[i], &x[k], &y[k], &w[k], &w[k], LOTE_AABB);
+        }
+    }, n * LOTE_AABB);
+    out.micro("aabb_batch_simd", n, ns, chequeo);
+
+    //lo mismo barrido: la bala avanza un paso de 30 Hz y los asteroides hasta 10 px (uno de cada 8
+    //quieto en y, y todos quietos junto con la bala en x cada 16 balas, para pasar por dd == 0)
+    MiVector<float> mx, my, bmx, bmy;
+    for (int i = 0; i < n * LOTE_AABB; i++) {
+        mx.push_back(azar.uniforme(-10, 10));
+        my.push_back(i % 8 == 0 ? 0.0f : azar.uniforme(-10, 10));
+    }
+    for (int i = 0; i < n; i++) {
+        float ang = azar.uniforme(0, 2 * PI);
+        bmx.push_back(i % 16 == 0 ? 0.0f : cosf(ang) * BULLET_SPEED / 30); bmy.push_back(sinf(ang) * BULLET_SPEED / 30);
+        if (i % 16 == 0) for (int j = 0; j < LOTE_AABB; j++) mx[i * LOTE_AABB + j] = 0.0f;
+    }
+    ns = MejorNs([&] {
+        chequeo = 0;
+        for (int i = 0; i < n; i++) {
+            int k = i * LOTE_AABB;
+            chequeo += BarridoContraLoteEscalar(balas[i], bmx[i], bmy[i], &x[k], &y[k], &w[k], &w[k], &mx[k], &my[k], LOTE_AABB);
+        }
+    }, n * LOTE_AABB);
+    out.micro("aabb_swept_scalar", n, ns, chequeo);
+    ns = MejorNs([&] {
+        chequeo = 0;
+        for (int i = 0; i < n; i++) {
+            int k = i * LOTE_AABB;
+            chequeo += BarridoContraLote(balas[i], bmx[i], bmy[i], &x[k], &y[k], &w[k], &w[k], &mx[k], &my[k], LOTE_AABB);
+        }
+    }, n * LOTE_AABB);
+    out.micro("aabb_swept_simd", n, ns, chequeo);
+}
+
+//n asteroides chicos y n balas en direcciones al azar, con el bot en el centro
+void ArmarEscena(World& world, int n, const Distribucion& dist, Azar& azar) {
+    world.reset(true);
+    world.asteroides.clear(); //se descartan los 10 de la partida normal (todavia no estan en la broadphase)
+    for (int i = 0; i < n; i++) {
+        float x, y;
+        dist.punto(azar, x, y);
+        world.spawnAsteroid(x, y, 1); //los chicos (20 px), los que mas abundan en una partida
+    }
+    for (int i = 0; i < n; i++) {
+        float x, y;
+        dist.punto(azar, x, y);
+        float ang = azar.uniforme(0, 2 * PI);
+        world.balas.push(x, y, cosf(ang) * BULLET_SPEED, sinf(ang) * BULLET_SPEED);
+    }
+}
+
+//foto completa del mundo con n asteroides y n balas (ns por entidad)
+void BenchSnapshot(SalidaJSON& out, int n, Azar& azar) {
+    World world(n, n);
+    Distribucion dist(false, azar);
+    ArmarEscena(world, n, dist, azar);
+    Snapshot foto;
+    foto.capturar(world, 0); //el buffer crece aqui, no dentro de la medicion
+    double ns = MejorNs([&] { foto.capturar(world, 0); }, 2 * n);
+    out.micro("snapshot_capture", n, ns, (long long)foto.tamanio());
+    ns = MejorNs([&] { foto.restaurar(world); }, 2 * n);
+    out.micro("snapshot_restore", n, ns, (long long)world.asteroides.count());
+}
+
+//Costo de crear asteroides, como en una cascada de divisiones: n altas (grandes, medianos y chicos) por
+//vuelta; y de pasar sus contornos a pantalla
+void BenchFormas(SalidaJSON& out, int n, Azar& azar) {
+    World world(n, 16);
+    MiVector<float> x, y;
+    for (int i = 0; i < n; i++) { x.push_back(azar.uniforme(0, SCREEN_WIDTH)); y.push_back(azar.uniforme(0, SCREEN_HEIGHT)); }
+    double ns = MejorNs([&] {
+        world.asteroides.clear();
+        for (int i = 0; i < n; i++) world.spawnAsteroid(x[i], y[i], 3 - i % 3);
+    }, n);
+    out.micro("asteroid_spawn", n, ns, (long long)world.asteroides.count());
+    ns = MejorNs([&] { world.actualizarContornos(); }, n); //contornos en pantalla de todos, como una vez por tick
+    out.micro("asteroid_outlines", n, ns, (long long)world.contornos.puntos());
+}
+
+//Lo que pregunta cada bot por tick sobre n asteroides: el mas cercano y si hay algo en la linea de tiro.
+//"scan" es el recorrido lineal de antes; el resto, nearest() y raycast() de cada broadphase (ns por bot).
+void BenchVecinos(SalidaJSON& out, int n, Azar& azar) {
+    const int BOTS = 64;
+    const float ALCANCE = BULLET_SPEED * BULLET_LIFETIME;
+    World world(n, n);
+    Distribucion dist(false, azar);
+    ArmarEscena(world, n, dist, azar);
+    world.balas.clear();
+    float px[BOTS], py[BOTS], dx[BOTS], dy[BOTS];
+    for (int b = 0; b < BOTS; b++) {
+        float ang = azar.uniforme(0, 2 * PI);
+        px[b] = azar.uniforme(0, SCREEN_WIDTH); py[b] = azar.uniforme(0, SCREEN_HEIGHT); dx[b] = cosf(ang); dy[b] = sinf(ang);
+    }
+    const Asteroides& ast = world.asteroides;
+    long long chequeo = 0;
+    double ns = MejorNs([&] {
+        chequeo = 0;
+        for (int b = 0; b < BOTS; b++) {
+            Vecino v = { { TIPO_ASTEROIDE, 0 }, 0.0f }; int k = 0;
+            for (size_t i = 0; i < ast.count(); i++) AgregarVecino(&v, k, 1, { TIPO_ASTEROIDE, (unsigned)i }, Dist2Centro(ast.bounds(i), px[b], py[b]));
+            if (k) chequeo += v.ref.indice; //sin asteroides no hay vecino
+        }
+    }, BOTS);
+    out.micro("bot_nearest_scan", n, ns, chequeo);
+    ns = MejorNs([&] {
+        chequeo = 0;
+        for (int b = 0; b < BOTS; b++) {
+            Impacto hit = {}; bool hay = false; float t;
+            for (size_t i = 0; i < ast.count(); i++) {
+                if (RayoCaja(px[b], py[b], 1.0f / dx[b], 1.0f / dy[b], ast.bounds(i), ALCANCE, t)) MejorImpacto(hit, hay, { TIPO_ASTEROIDE, (unsigned)i }, t);
+            }
+            if (hay) chequeo += hit.ref.indice;
+        }
+    }, BOTS);
+    out.micro("bot_raycast_scan", n, ns, chequeo);
+
+    const char* nombres[BP_TOTAL] = { "quadtree", "grid", "sap" };
+    char nombre[64];
+    for (int b = 0; b < BP_TOTAL; b++) {
+        world.setBroadphase((TipoBroadphase)b);
+        world.step(0.0f, InputState()); //inserta todo (sin balas no se destruye nada)
+        ns = MejorNs([&] {
+            chequeo = 0;
+            for (int k = 0; k < BOTS; k++) {
+                Vecino v;
+                if (world.broadphase->nearest(px[k], py[k], TIPO_ASTEROIDE, 1, &v)) chequeo += v.ref.indice;
+            }
+        }, BOTS);
+        snprintf(nombre, sizeof(nombre), "bot_nearest_%s", nombres[b]);
+        out.micro(nombre, n, ns, chequeo);
+        ns = MejorNs([&] {
+            chequeo = 0;
+            for (int k = 0; k < BOTS; k++) {
+                Impacto hit;
+                if (world.broadphase->raycast(px[k], py[k], dx[k], dy[k], ALCANCE, TIPO_ASTEROIDE, hit)) chequeo += hit.ref.indice;
+            }
+        }, BOTS);
+        snprintf(nombre, sizeof(nombre), "bot_raycast_%s", nombres[b]);
+        out.micro(nombre, n, ns, chequeo);
+    }
+}
+
+//Cada repeticion arma la escena de cero y mide dos steps: el primero inserta todo en la broadphase y
+//resuelve las colisiones con la densidad pedida; el segundo ya es incremental pero sobre lo que sobrevivio.
+void BenchFrames(SalidaJSON& out, int n, const OpcionesBench& op, JobSystem& jobs) {
+    const char* nombres[2] = { "uniform", "clustered" };
+    InputState sinTeclas;
+    for (int d = 0; d < 2; d++) {
+        for (int b = 0; b < BP_TOTAL; b++) {
+            const char* nombreBP = b == BP_QUADTREE ? "quadtree" : (b == BP_GRID ? "grid" : "sap");
+            double mejorPrimero = 1e30, mejorSiguiente = 1e30, pares = 0, tests = 0;
+            int nodos = 0;
+            bool excedido = false;
+            auto inicio = Reloj::now();
+            for (int r = 0; r < 1 || (r < op.frames && SegundosDesde(inicio) < 2.0); r++) { //las escenas enormes se cortan a los ~2 s
+                World world(n, n);
+                world.setBroadphase((TipoBroadphase)b);
+                world.jobs = &jobs;
+                world.maxPares = op.maxPares;
+                Azar azar(op.seed);
+                world.sembrar(op.seed);
+                Distribucion dist(d == 1, azar);
+                ArmarEscena(world, n, dist, azar);
+
+                auto t0 = Reloj::now();
+                world.step(1.0f / 60.0f, sinTeclas);
+                mejorPrimero = std::min(mejorPrimero, SegundosDesde(t0) * 1e3);
+                if (world.paresExcedidos) { excedido = true; break; } //la escena no cabe: no hay frame que medir
+                pares = world.broadphase->getCandidatos();
+                tests = world.testsNarrowphase;
+                nodos = world.broadphase->nodeCount();
+
+                t0 = Reloj::now();
+                world.step(1.0f / 60.0f, sinTeclas);
+                mejorSiguiente = std::min(mejorSiguiente, SegundosDesde(t0) * 1e3);
+            }
+            if (excedido) { //la lista de pares no entra en el presupuesto: ahi se cae el diseno
+                out.falla(nombreBP, nombres[d], n, "over_budget");
+                fprintf(stderr, "frame %-8s %-9s n=%-6d mas de %zu pares\n", nombreBP, nombres[d], n, op.maxPares);
+                continue;
+            }
+            out.frame(nombreBP, nombres[d], n, mejorPrimero, mejorSiguiente, pares, tests, nodos);
+            fprintf(stderr, "frame %-8s %-9s n=%-6d %10.3f ms\n", nombreBP, nombres[d], n, mejorPrimero);
+        }
+    }
+}
+
+// ------------------------------------------
+// AUTOTUNE DEL QUADTREE
+// ------------------------------------------
+//Una escena grabada es la secuencia exacta de llamadas que World le hizo a la broadphase durante
+//varios ticks. Reproducirla sobre cada configuracion mide solo la estructura, con la misma carga.
+enum TipoOp { OP_INSERT, OP_MOVE, OP_REMOVE, OP_SETREF, OP_RETRIEVE, OP_PAIRS, OP_FRAME, OP_CLEAR };
+
+struct OpGrabada {
+    int tipo;
+    int id;
+    BroadItem item;
+};
+
+class BroadphaseGrabada : public Broadphase { //envuelve a la broadphase real y anota todo lo que se le pide
+    Broadphase* real;
+    MiVector<OpGrabada>& log;
+    int frames;
+
+    void anotar(int tipo, int id, const BroadItem& item) { log.push_back({ tipo, id, item }); }
+
+public:
+    BroadphaseGrabada(Broadphase* _real, MiVector<OpGrabada>& _log) : real(_real), log(_log), frames(0) {}
+    ~BroadphaseGrabada() { delete real; }
+
+    const char* nombre() const override { return real->nombre(); }
+    int getFrames() const { return frames; }
+
+    void clear() override { anotar(OP_CLEAR, -1, {}); real->clear(); }
+    void reservar(size_t n) override { real->reservar(n); }
+    int insert(const BroadItem& item) override {
+        int id = real->insert(item);
+        anotar(OP_INSERT, id, item);
+        return id;
+    }
+    void move(int id, const Rect& b) override { anotar(OP_MOVE, id, { b, {} }); real->move(id, b); }
+    void remove(int id) override { anotar(OP_REMOVE, id, {}); real->remove(id); }
+    void setRef(int id, EntityRef ref) override { anotar(OP_SETREF, id, { {}, ref }); real->setRef(id, ref); }
+    bool query(const Rect& r, Visitante visita) override { anotar(OP_RETRIEVE, -1, { r, {} }); return real->query(r, visita); }
+    //las consultas del bot no se graban: el autotune solo compara altas, bajas, movimientos y pares
+    int nearest(float px, float py, TipoEntidad tipo, int k, Vecino* out) override { return real->nearest(px, py, tipo, k, out); }
+    bool raycast(float ox, float oy, float dx, float dy, float tMax, TipoEntidad tipo, Impacto& hit) override {
+        return real->raycast(ox, oy, dx, dy, tMax, tipo, hit);
+    }
+    void prepararPares() override { anotar(OP_PAIRS, -1, {}); real->prepararPares(); } //lo llama findPairs()
+    size_t tareasPares() const override { return real->tareasPares(); }
+    void paresTarea(size_t desde, size_t hasta, MiVector<ColPair>& pares) const override { real->paresTarea(desde, hasta, pares); }
+    int nodeCount() const override { return real->nodeCount(); }
+    void resetContadores() override { anotar(OP_FRAME, -1, {}); frames++; real->resetContadores(); }
+};
+
+//reproduce el log sobre un quadtree con otros parametros; los ids grabados se traducen a los nuevos
+template <int C, int D, typename T>
+double Reproducir(const MiVector<OpGrabada>& log) {
+    QuadtreeT<C, D, T> qt(0, { 0, 0, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT });
+    MiVector<int> ids;
+    MiVector<ColPair> pares;
+    qt.reservar(log.size());
+    auto t0 = Reloj::now();
+    for (size_t k = 0; k < log.size(); k++) {
+        const OpGrabada& op = log[k];
+        switch (op.tipo) {
+            case OP_INSERT:
+                if ((size_t)op.id >= ids.size()) ids.resize(op.id + 1);
+                ids[op.id] = qt.insert(op.item);
+                break;
+            case OP_MOVE: qt.move(ids[op.id], op.item.bounds); break;
+            case OP_REMOVE: qt.remove(ids[op.id]); break;
+            case OP_SETREF: qt.setRef(ids[op.id], op.item.ref); break;
+            case OP_RETRIEVE: qt.visitar(op.item.bounds, [](const BroadItem&) { return true; }); break;
+            case OP_PAIRS: pares.clear(); qt.findPairs(pares); break;
+            case OP_FRAME: qt.resetContadores(); break;
+            case OP_CLEAR: qt.clear(); break;
+        }
+    }
+    return SegundosDesde(t0) * 1e3;
+}
+
+struct Escena {
+    const char* nombre;
+    int n;
+    int frames;
+    MiVector<OpGrabada> log;
+};
+
+struct ResultadoConfig {
+    char nombre[32];
+    double ms; //suma de los ms por frame de todas las escenas del mismo tamanio
+};
+
+template <int C, int D, typename T>
+void ProbarConfig(const char* coord, MiVector<Escena>& escenas, int n, SalidaJSON& out, MiVector<ResultadoConfig>& res) {
+    ResultadoConfig r;
+    snprintf(r.nombre, sizeof(r.nombre), "%d/%d/%s", C, D, coord);
+    r.ms = 0;
+    for (size_t e = 0; e < escenas.size(); e++) {
+        if (escenas[e].n != n) continue;
+        double mejor = 1e30;
+        for (int rep = 0; rep < 3; rep++) mejor = std::min(mejor, Reproducir<C, D, T>(escenas[e].log));
+        double porFrame = mejor / std::max(escenas[e].frames, 1);
+        out.autotune(escenas[e].nombre, n, r.nombre, porFrame, false);
+        r.ms += porFrame;
+    }
+    res.push_back(r);
+}
+
+template <int C, typename T>
+void ProbarProfundidades(const char* coord, MiVector<Escena>& escenas, int n, SalidaJSON& out, MiVector<ResultadoConfig>& res) {
+    ProbarConfig<C, 4, T>(coord, escenas, n, out, res);
+    ProbarConfig<C, 5, T>(coord, escenas, n, out, res);
+    ProbarConfig<C, 6, T>(coord, escenas, n, out, res);
+    ProbarConfig<C, 7, T>(coord, escenas, n, out, res);
+    ProbarConfig<C, 8, T>(coord, escenas, n, out, res);
+}
+
+template <typename T>
+void ProbarCapacidades(const char* coord, MiVector<Escena>& escenas, int n, SalidaJSON& out, MiVector<ResultadoConfig>& res) {
+    ProbarProfundidades<2, T>(coord, escenas, n, out, res);
+    ProbarProfundidades<4, T>(coord, escenas, n, out, res);
+    ProbarProfundidades<8, T>(coord, escenas, n, out, res);
+    ProbarProfundidades<16, T>(coord, escenas, n, out, res);
+    ProbarProfundidades<32, T>(coord, escenas, n, out, res);
+}
+
+//graba 'ticks' steps de un World ya armado
+void Grabar(World& world, Escena& escena, int ticks) {
+    BroadphaseGrabada* g = new BroadphaseGrabada(CrearBroadphase(BP_QUADTREE), escena.log);
+    world.usarBroadphase(g, BP_QUADTREE);
+    InputState sinTeclas;
+    for (int t = 0; t < ticks && !world.victoria(); t++) world.step(1.0f / 60.0f, sinTeclas);
+    escena.frames = g->getFrames();
+}
+
+void Autotune(SalidaJSON& out, const OpcionesBench& op) {
+    MiVector<Escena> escenas;
+    const int tamanios[3] = { 100, 1000, 10000 }; //con 100k la lista de pares ya no entra en memoria (ver frames)
+
+    { //una partida normal del bot: pocas entidades y casi siempre las mismas
+        Escena& e = escenas.emplace_back();
+        e.nombre = "game"; e.n = 0;
+        World world;
+        world.sembrar(op.seed);
+        world.reset(true);
+        Grabar(world, e, 60 * 60);
+    }
+    for (int t = 0; t < 3 && tamanios[t] <= op.maxN; t++) {
+        for (int d = 0; d < 2; d++) {
+            Escena& e = escenas.emplace_back();
+            e.nombre = d ? "clustered" : "uniform"; e.n = tamanios[t];
+            World world(tamanios[t], tamanios[t]);
+            Azar azar(op.seed);
+            world.sembrar(op.seed);
+            Distribucion dist(d == 1, azar);
+            ArmarEscena(world, tamanios[t], dist, azar);
+            Grabar(world, e, 60);
+        }
+    }
+
+    for (int t = -1; t < 3; t++) {
+        int n = t < 0 ? 0 : tamanios[t];
+        if (n > op.maxN) break;
+        MiVector<ResultadoConfig> res;
+        ProbarCapacidades<float>("float", escenas, n, out, res);
+        ProbarCapacidades<int>("int", escenas, n, out, res);
+        size_t mejor = 0, actual = 0;
+        for (size_t k = 0; k < res.size(); k++) {
+            if (res[k].ms < res[mejor].ms) mejor = k;
+            if (!strcmp(res[k].nombre, "4/5/float")) actual = k; //la configuracion de siempre, como referencia
+        }
+        out.autotune("best", n, res[mejor].nombre, res[mejor].ms, true);
+        char etiqueta[16];
+        if (n) snprintf(etiqueta, sizeof(etiqueta), "n=%d", n); else snprintf(etiqueta, sizeof(etiqueta), "partida");
+        fprintf(stderr, "autotune %-8s mejor %-10s %9.4f ms/frame (4/5/float: %.4f)\n", etiqueta,
+                res[mejor].nombre, res[mejor].ms, res[actual].ms);
+    }
+}
+
+int main(int argc, char** argv) {
+    OpcionesBench op = LeerOpciones(argc, argv);
+    FILE* f = op.out ? fopen(op.out, "w") : stdout;
+    if (!f) { fprintf(stderr, "no se pudo abrir %s\n", op.out); return 1; }
+
+    const int tamanios[4] = { 100, 1000, 10000, 100000 };
+    {
+        SalidaJSON out(f);
+        Azar azar(op.seed);
+        JobSystem jobs(op.threads);
+        out.hilos(jobs.hilos());
+        if (op.autotune) {
+            Autotune(out, op);
+        } else {
+            for (int t = 0; t < 4 && tamanios[t] <= op.maxN; t++) {
+                BenchQuadtree(out, tamanios[t], azar);
+                BenchMiVector(out, tamanios[t]);
+                BenchSimd(out, tamanios[t], azar);
+                BenchSnapshot(out, tamanios[t], azar);
+                BenchFormas(out, tamanios[t], azar);
+                BenchVecinos(out, tamanios[t], azar);
+            }
+            for (int t = 0; t < 4 && tamanios[t] <= op.maxN; t++) BenchFrames(out, tamanios[t], op, jobs);
+        }
+    }
+    if (f != stdout) fclose(f);
+    return 0;
+}
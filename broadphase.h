@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+
+#include "mivector.h"
+#include "geometria.h"
+
+// ------------------------------------------
+// PARTE 3: BROADPHASE (INTERFAZ COMUN)
+// ------------------------------------------
+//El World no sabe que estructura espacial usa: habla con esta interfaz y el backend se elige en
+//tiempo de ejecucion (quadtree, grilla hash o sort-and-sweep) segun la densidad de la escena.
+
+//lo que guarda la broadphase: la caja de colision y a que entidad pertenece
+struct BroadItem {
+    Rect bounds;
+    EntityRef ref;
+};
+
+//par candidato para la narrowphase: a = bala o jugador, b = asteroide
+struct ColPair {
+    EntityRef a;
+    EntityRef b;
+};
+
+//Solo interesan bala-asteroide y jugador-asteroide (bala-bala o asteroide-asteroide no hacen nada).
+//Ordena el par para que el asteroide quede en b.
+inline bool FiltrarPar(EntityRef p, EntityRef q, ColPair& out) {
+    if (q.tipo == TIPO_ASTEROIDE && p.tipo != TIPO_ASTEROIDE) { out = { p, q }; return true; }
+    if (p.tipo == TIPO_ASTEROIDE && q.tipo != TIPO_ASTEROIDE) { out = { q, p }; return true; }
+    return false;
+}
+
+//orden de los pares por indice de entidad, el mismo con cualquier broadphase y cualquier historia
+inline bool MenorPar(const ColPair& p, const ColPair& q) {
+    if (p.a.tipo != q.a.tipo) return p.a.tipo < q.a.tipo;
+    if (p.a.indice != q.a.indice) return p.a.indice < q.a.indice;
+    return p.b.indice < q.b.indice;
+}
+
+//resultado de retrieve: con 32 lugares internos una consulta normal no pide memoria
+typedef MiVector<EntityRef, 32> Candidatos;
+
+//Lo que recibe query(): un puntero a la lambda del que consulta y una funcion que la llama (como
+//std::function pero sin pedir memoria ni copiar la lambda). La lambda devuelve false para cortar.
+class Visitante {
+private:
+    void* ctx;
+    bool (*fn)(void*, const BroadItem&);
+
+public:
+    template <typename F>
+    Visitante(F& f) : ctx(&f), fn([](void* c, const BroadItem& it) { return (bool)(*static_cast<F*>(c))(it); }) {}
+    bool operator()(const BroadItem& it) const { return fn(ctx, it); }
+};
+
+//Rect::intersects sin saltos (& en vez de &&): en una consulta casi todas las cajas fallan por un
+//lado distinto y los saltos de && se predicen mal.
+inline bool SeSolapan(const Rect& a, const Rect& b) {
+    return (a.x < b.x + b.width) & (a.x + a.width > b.x) & (a.y < b.y + b.height) & (a.y + a.height > b.y);
+}
+
+//resultado de nearest(): distancia al cuadrado del punto de la consulta al centro de la caja
+struct Vecino {
+    EntityRef ref;
+    float dist2;
+};
+
+//resultado de raycast(): t = distancia desde el origen hasta donde el rayo entra en la caja
+struct Impacto {
+    EntityRef ref;
+    float t;
+};
+
+inline float Dist2Centro(const Rect& r, float px, float py) {
+    float dx = r.x + r.width / 2 - px, dy = r.y + r.height / 2 - py;
+    return dx * dx + dy * dy;
+}
+
+//distancia al cuadrado del punto al rectangulo [x0, x1] x [y0, y1] (0 si esta adentro); cota inferior para podar
+inline float Dist2Caja(float x0, float y0, float x1, float y1, float px, float py) {
+    float dx = px < x0 ? x0 - px : (px > x1 ? px - x1 : 0);
+    float dy = py < y0 ? y0 - py : (py > y1 ? py - y1 : 0);
+    return dx * dx + dy * dy;
+}
+inline float Dist2Caja(const Rect& r, float px, float py) { return Dist2Caja(r.x, r.y, r.x + r.width, r.y + r.height, px, py); }
+
+//Mantiene out[0..n) ordenado y con a lo mas k vecinos. A igual distancia gana el indice menor, asi
+//el resultado no depende del orden en que cada backend recorre sus objetos.
+inline bool AntesQue(float d2, EntityRef a, float otraD2, EntityRef b) {
+    return d2 < otraD2 || (d2 == otraD2 && a.indice < b.indice);
+}
+inline void AgregarVecino(Vecino* out, int& n, int k, EntityRef ref, float d2) {
+    if (n == k && !AntesQue(d2, ref, out[k - 1].dist2, out[k - 1].ref)) return;
+    int i = (n < k) ? n++ : k - 1; //si ya estaba lleno se descarta el ultimo
+    while (i > 0 && AntesQue(d2, ref, out[i - 1].dist2, out[i - 1].ref)) { out[i] = out[i - 1]; i--; }
+    out[i] = { ref, d2 };
+}
+
+//Rayo contra caja (slabs). inv = 1/direccion (infinito si la componente es 0). Si el origen esta
+//adentro t = 0. Devuelve false si no la toca antes de tMax.
+inline bool RayoCaja(float ox, float oy, float invX, float invY, float x0, float y0, float x1, float y1, float tMax, float& t) {
+    float tx0 = (x0 - ox) * invX, tx1 = (x1 - ox) * invX;
+    float ty0 = (y0 - oy) * invY, ty1 = (y1 - oy) * invY;
+    float tEntra = std::max(std::min(tx0, tx1), std::min(ty0, ty1));
+    float tSale = std::min(std::max(tx0, tx1), std::max(ty0, ty1));
+    if (tSale < 0 || tEntra > tSale || tEntra > tMax) return false;
+    t = tEntra > 0 ? tEntra : 0;
+    return true;
+}
+inline bool RayoCaja(float ox, float oy, float invX, float invY, const Rect& r, float tMax, float& t) {
+    return RayoCaja(ox, oy, invX, invY, r.x, r.y, r.x + r.width, r.y + r.height, tMax, t);
+}
+
+inline void MejorImpacto(Impacto& mejor, bool& hay, EntityRef ref, float t) {
+    if (!hay || t < mejor.t || (t == mejor.t && ref.indice < mejor.ref.indice)) { mejor = { ref, t }; hay = true; }
+}
+
+enum TipoBroadphase { BP_QUADTREE, BP_GRID, BP_SAP, BP_TOTAL };
+
+class Broadphase {
+protected:
+    int candidatos = 0; //candidatos entregados (retrieve + findPairs) desde resetContadores()
+
+    size_t topePares = (size_t)-1; //largo maximo de cada lista de paresTarea (ver setTopePares)
+
+    //Sin contar: puede correr en varios hilos. Solo sale el par si las cajas se tocan; las celdas y los
+    //nodos juntan objetos cercanos pero no solapados, y la narrowphase no deberia ver esos pares.
+    void emitir(MiVector<ColPair>& pares, const BroadItem& p, const BroadItem& q) const {
+        ColPair par;
+        if (!lleno(pares) && FiltrarPar(p.ref, q.ref, par) && SeSolapan(p.bounds, q.bounds)) pares.push_back(par);
+    }
+    //la lista llego al tope: paresTarea deja de enumerar (lo que falta no se va a agregar)
+    bool lleno(const MiVector<ColPair>& pares) const { return pares.size() >= topePares; }
+
+public:
+    virtual ~Broadphase() = default;
+    virtual const char* nombre() const = 0;
+
+    virtual void clear() = 0;
+    virtual void reservar(size_t) {} //memoria para n objetos de una vez, para no crecer en medio del juego
+    virtual int insert(const BroadItem& item) = 0; //devuelve el id del objeto para move()/remove()
+    virtual void move(int id, const Rect& newBounds) = 0;
+    virtual void remove(int id) = 0;
+    virtual void setRef(int id, EntityRef ref) = 0; //cuando la entidad cambia de indice en su arreglo
+
+    //Llama a visita con cada objeto cuya caja se solapa con r, en el lugar, sin armar ninguna lista.
+    //Si visita devuelve false no se mira nada mas y query devuelve false. No es thread-safe (arma lo
+    //que falte, igual que prepararPares).
+    virtual bool query(const Rect& r, Visitante visita) = 0;
+
+    template <typename F>
+    bool visitar(const Rect& r, F f) { return query(r, Visitante(f)); }
+
+    //hay algun objeto de ese tipo tocando r? (corta en el primero)
+    bool hayAlguno(const Rect& r, TipoEntidad tipo) {
+        return !visitar(r, [&](const BroadItem& it) { return it.ref.tipo != tipo; });
+    }
+
+    //agrega a returnObjects los objetos que se solapan con pRect (para el que necesita la lista)
+    void retrieve(Candidatos& returnObjects, const Rect& pRect) {
+        size_t antes = returnObjects.size();
+        visitar(pRect, [&](const BroadItem& it) { returnObjects.push_back(it.ref); return true; });
+        candidatos += (int)(returnObjects.size() - antes);
+    }
+
+    //los k objetos de ese tipo con el centro mas cerca de (px, py), ordenados; devuelve cuantos hay en out
+    virtual int nearest(float px, float py, TipoEntidad tipo, int k, Vecino* out) = 0;
+
+    //el primer objeto de ese tipo que toca el rayo origen + t * (dx, dy), con (dx, dy) unitario y t <= tMax
+    virtual bool raycast(float ox, float oy, float dx, float dy, float tMax, TipoEntidad tipo, Impacto& hit) = 0;
+
+    //agrega a pares cada par interesante (ver FiltrarPar) exactamente una vez, sin el simetrico
+    virtual void findPairs(MiVector<ColPair>& pares) {
+        prepararPares();
+        size_t antes = pares.size();
+        paresTarea(0, tareasPares(), pares);
+        contarCandidatos((int)(pares.size() - antes));
+    }
+
+    //findPairs en partes independientes para repartirlas entre hilos: prepararPares() una vez (arma lo
+    //que falte, no es thread-safe) y despues paresTarea() sobre rangos disjuntos de [0, tareasPares())
+    //desde cualquier hilo. Concatenar los rangos en orden da exactamente la lista de findPairs().
+    virtual void prepararPares() {}
+    virtual size_t tareasPares() const = 0;
+    virtual void paresTarea(size_t desde, size_t hasta, MiVector<ColPair>& pares) const = 0;
+    void contarCandidatos(int n) { candidatos += n; }
+
+    //Tope para escenas de prueba donde los pares no entran en memoria (0 = sin tope): una lista que llega
+    //a 'tope' pares no crece mas y el que llama sabe que se paso mirando su largo.
+    void setTopePares(size_t tope) { topePares = tope ? tope : (size_t)-1; }
+
+    virtual void getAllBounds(MiVector<Rect>&) const {} //celdas/nodos para el overlay de debug
+    virtual int nodeCount() const { return 0; }
+    virtual int getAllocaciones() const { return 0; }
+    virtual int getReinserciones() const { return 0; }
+
+    virtual void resetContadores() { candidatos = 0; } //se llama al inicio de cada frame
+    int getCandidatos() const { return candidatos; }
+};
+
+//Tabla de objetos con ids reutilizables, la usan los backends que no guardan los objetos en nodos
+class ProxyTable {
+public:
+    MiVector<BroadItem> items; //el indice es el id
+    MiVector<bool> alive;
+    MiVector<int> freeIds;
+
+    int add(const BroadItem& item) {
+        int id;
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+            items[id] = item;
+            alive[id] = true;
+        } else {
+            id = (int)items.size();
+            items.push_back(item);
+            alive.push_back(true);
+        }
+        return id;
+    }
+    void kill(int id) { alive[id] = false; } //el id no se reutiliza hasta que se llame release()
+    void release(int id) { freeIds.push_back(id); }
+    void reservar(size_t n) { items.reserve(n); alive.reserve(n); freeIds.reserve(n); }
+    void clear() { items.clear(); alive.clear(); freeIds.clear(); }
+};
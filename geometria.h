@@ -0,0 +1,54 @@
+#pragma once
+
+// -------------------------------------------
+// PARTE 2: GEOMETRIA Y ENTIDADES
+// -------------------------------------------
+
+//la simulacion no depende de raylib, asi que definimos las constantes que usabamos de ahi
+//(si raylib.h ya se incluyo, se respetan las suyas)
+#ifndef PI
+#define PI 3.14159265358979323846f
+#endif
+#ifndef DEG2RAD
+#define DEG2RAD (PI/180.0f)
+#endif
+#ifndef RAD2DEG
+#define RAD2DEG (180.0f/PI)
+#endif
+
+const int SCREEN_WIDTH = 800;
+const int SCREEN_HEIGHT = 500;
+
+struct Vec2 { //para física de vectores
+    float x, y;
+};
+
+struct Rect { //para limites del Quadtree y para las cajas de colisión de las entidades.
+    float x, y;
+    float width, height;
+    bool intersects(const Rect& other) const {//verifica si un rectangulo intersecta con otro
+        return (x < other.x + other.width && x + width > other.x &&
+                y < other.y + other.height && y + height > other.y);
+    }
+    bool contains(const Rect& other) const {//verifica si un rect contiene otro adentro, util para saber si un objeto cabe en un nodo hijo
+        return (other.x >= x &&
+                other.x + other.width <= x + width &&
+                other.y >= y &&
+                other.y + other.height <= y + height);
+    }
+};
+
+//estado de las teclas en un tick; lo llena main.cpp con raylib o el runner headless a mano
+struct InputState {
+    bool left = false, right = false; //rotar
+    bool thrust = false, brake = false; //acelerar / frenar
+    bool shoot = false; //disparo (flanco: solo el tick en que se presiona)
+};
+
+//Etiqueta de tipo: reemplaza al dynamic_cast. Con el indice se llega a los arreglos del tipo en World.
+enum TipoEntidad : unsigned char { TIPO_JUGADOR, TIPO_ASTEROIDE, TIPO_BALA };
+
+struct EntityRef {
+    TipoEntidad tipo;
+    unsigned indice; //posicion dentro de los arreglos de su tipo
+};
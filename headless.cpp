@@ -0,0 +1,360 @@
+/**
+ * ASTEROIDS HEADLESS
+ * Corre partidas del bot sin ventana ni GPU, con dt fijo, tan rapido como de el CPU.
+ * Uso: ./headless [--games N] [--max-ticks N] [--dt S] [--seed N] [--broadphase quadtree|grid|sap]
+ *                  [--profile] [--profile-csv archivo] [--profile-trace archivo] [--threads N]
+ *                  [--record archivo] [--replay archivo] [--checkpoint N] [--bots N] [--render]
+ *                  [--workers N] [--scaling] [--bot-evade PX] [--bot-cone GRADOS] [--bot-fire PCT] [--bot-lead F] [--bot-los]
+ *                  [--rewind-check N]
+ * La partida g usa la semilla seed + g. --record guarda la primera (dt, teclas y hashes, ver replay.h);
+ * --replay vuelve a simular una grabacion (del headless o del juego) y compara los hashes.
+ * --render arma el lote de cada tick (con overlay y hitboxes) contra un backend que solo cuenta.
+ * --workers N reparte las partidas entre N hilos (0 = todos los nucleos), un World por hilo (partidas.h), y
+ * resume tiempo, balas y perdidas en percentiles; --scaling repite el lote con 1, 2, 4... hilos y compara.
+ * --bot-* cambian ParametrosBot para evaluar variantes del bot (no se pueden grabar).
+ * --rewind-check N guarda una foto por tick como el juego y cada N ticks rebobina N: cada paso atras tiene que
+ * caer en el tick anterior, y al volver a jugarlos los hashes tienen que ser los mismos (broadphase de cero).
+ * --dt 0.0333333 corre a 30 Hz, como la opcion T del juego (las balas no atraviesan asteroides: prueba barrida).
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "world.h"
+#include "replay.h"
+#include "render.h"
+#include "partidas.h"
+#include "snapshot.h"
+
+//Contamos cada operator new del programa para comprobar que, pasada la primera partida, la
+//simulacion ya no pide memoria al heap (todo sale de los pools reservados en World).
+static std::atomic<long long> g_news(0); //atomico: con --threads tambien piden memoria los otros hilos
+
+void* operator new(size_t n) {
+    g_news++;
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+//Todas las formas de delete (con y sin tamanio) terminan en el mismo free, fuera de linea: si GCC
+//mete el free adentro de un delete ve free() sobre algo de operator new y avisa -Wmismatched-new-delete.
+__attribute__((noinline)) static void Liberar(void* p) noexcept { free(p); }
+void operator delete(void* p) noexcept { Liberar(p); }
+void operator delete[](void* p) noexcept { Liberar(p); }
+void operator delete(void* p, size_t) noexcept { Liberar(p); }
+void operator delete[](void* p, size_t) noexcept { Liberar(p); }
+
+const size_t MAX_NODOS_OVERLAY = 1024; //celdas/nodos de broadphase que puede dibujar el overlay de --render
+
+struct OpcionesHeadless {
+    int games = 1000;
+    int maxTicks = 60 * 120; //2 minutos de juego a 60 Hz
+    float dt = 1.0f / 60.0f;
+    unsigned seed = 1;
+    TipoBroadphase broadphase = BP_QUADTREE;
+    bool profile = false; //tiempos por fase de los ultimos ticks
+    const char* profileCSV = nullptr;
+    const char* profileTrace = nullptr; //formato Chrome trace (chrome://tracing, Perfetto)
+    int threads = 1; //0 = todos los nucleos; solo se usan en escenas grandes (ver World::MIN_PARALELO)
+    const char* record = nullptr;
+    const char* replay = nullptr;
+    int checkpoint = 60; //ticks entre hashes al grabar
+    int bots = 1; //enjambre para pruebas de carga (todos apuntan con nearest/raycast de la broadphase)
+    bool render = false;
+    int workers = -1; //-1 = sin lote (una partida tras otra en este hilo)
+    bool scaling = false;
+    ParametrosBot bot;
+    bool botCambiado = false;
+    int rebobinar = 0; //--rewind-check: ticks entre rebobinados, y cuantos se rebobina (0 = no se comprueba)
+};
+
+OpcionesHeadless LeerOpciones(int argc, char** argv) {
+    OpcionesHeadless op;
+    for (int i = 1; i < argc; i++) {
+        bool hayValor = (i + 1 < argc);
+        if (!strcmp(argv[i], "--games") && hayValor) op.games = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--max-ticks") && hayValor) op.maxTicks = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--dt") && hayValor) op.dt = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hayValor) op.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--broadphase") && hayValor) {
+            const char* v = argv[++i];
+            if (!strcmp(v, "quadtree")) op.broadphase = BP_QUADTREE;
+            else if (!strcmp(v, "grid")) op.broadphase = BP_GRID;
+            else if (!strcmp(v, "sap")) op.broadphase = BP_SAP;
+            else { fprintf(stderr, "broadphase desconocida: %s (quadtree|grid|sap)\n", v); exit(1); }
+        }
+        else if (!strcmp(argv[i], "--threads") && hayValor) op.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--record") && hayValor) op.record = argv[++i];
+        else if (!strcmp(argv[i], "--replay") && hayValor) op.replay = argv[++i];
+        else if (!strcmp(argv[i], "--checkpoint") && hayValor) op.checkpoint = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bots") && hayValor) op.bots = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--render")) op.render = true;
+        else if (!strcmp(argv[i], "--workers") && hayValor) op.workers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--scaling")) op.scaling = true;
+        else if (!strcmp(argv[i], "--bot-evade") && hayValor) { op.bot.radioEvasion = (float)atof(argv[++i]); op.botCambiado = true; }
+        else if (!strcmp(argv[i], "--bot-cone") && hayValor) { op.bot.conoDisparo = (float)atof(argv[++i]); op.botCambiado = true; }
+        else if (!strcmp(argv[i], "--bot-fire") && hayValor) { op.bot.probDisparo = atoi(argv[++i]); op.botCambiado = true; }
+        else if (!strcmp(argv[i], "--bot-lead") && hayValor) { op.bot.adelanto = (float)atof(argv[++i]); op.botCambiado = true; }
+        else if (!strcmp(argv[i], "--bot-los")) { op.bot.tiroEnLinea = true; op.botCambiado = true; }
+        else if (!strcmp(argv[i], "--rewind-check") && hayValor) op.rebobinar = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--profile")) op.profile = true;
+        else if (!strcmp(argv[i], "--profile-csv") && hayValor) { op.profileCSV = argv[++i]; op.profile = true; }
+        else if (!strcmp(argv[i], "--profile-trace") && hayValor) { op.profileTrace = argv[++i]; op.profile = true; }
+        else {
+            fprintf(stderr, "uso: %s [--games N] [--max-ticks N] [--dt S] [--seed N] [--broadphase quadtree|grid|sap]\n"
+                            "          [--profile] [--profile-csv archivo] [--profile-trace archivo] [--threads N]\n"
+                            "          [--record archivo] [--replay archivo] [--checkpoint N] [--bots N] [--render]\n"
+                            "          [--workers N] [--scaling] [--bot-evade PX] [--bot-cone GRADOS] [--bot-fire PCT] [--bot-lead F] [--bot-los]\n"
+                            "          [--rewind-check N]\n", argv[0]);
+            exit(1);
+        }
+    }
+    return op;
+}
+
+void ImprimirProfiler(const OpcionesHeadless& op, const Profiler& profiler) {
+    printf("profiler (ultimos %d ticks), us por fase: min / prom / p99\n", Profiler::CAPACIDAD);
+    for (int f = 0; f < FASE_TOTAL; f++) {
+        if (f == FASE_RENDER) continue; //aqui no se dibuja
+        ResumenFase r = profiler.resumen((FaseProfiler)f);
+        printf("  %-10s %8.2f %8.2f %8.2f\n", NombreFase(f), r.minUs, r.avgUs, r.p99Us);
+    }
+    if (op.profileCSV && !profiler.exportarCSV(op.profileCSV)) fprintf(stderr, "no se pudo escribir %s\n", op.profileCSV);
+    if (op.profileTrace && !profiler.exportarChromeTrace(op.profileTrace)) fprintf(stderr, "no se pudo escribir %s\n", op.profileTrace);
+}
+
+//--replay: sin ventana ni reloj, tan rapido como se pueda; sale con 1 si algun hash no coincide
+int CorrerReplay(const OpcionesHeadless& op) {
+    InputLog log;
+    if (!log.cargar(op.replay)) { fprintf(stderr, "no se pudo leer %s (o no es una grabacion)\n", op.replay); return 1; }
+    World world(256, 256 + 16 * log.bots);
+    JobSystem jobs(op.threads);
+    world.jobs = &jobs;
+    Profiler profiler;
+    if (op.profile) world.profiler = &profiler;
+
+    auto inicio = std::chrono::steady_clock::now();
+    ResultadoReplay r = Reproducir(world, log, op.profile ? &profiler : nullptr);
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+    printf("replay %s: semilla %u, %s, %zu ticks grabados\n", op.replay, log.semilla,
+           log.bot ? (log.bots > 1 ? "enjambre" : "bot") : "jugador", log.ticks());
+    printf("ticks: %u en %.3f s -> %.0f ticks/s\n", r.ticks, segundos, r.ticks / (segundos > 0 ? segundos : 1e-9));
+    printf("checkpoints: %u de %zu coinciden\n", r.verificados, log.checkpoints.size());
+    if (op.profile) {
+        printf("tick mas lento: %u (%.1f us)\n", r.tickMasLento, r.usMasLento);
+        ImprimirProfiler(op, profiler);
+    }
+    if (r.tickDivergencia >= 0) {
+        printf("DIVERGE en el tick %lld: hash %016llx, esperado %016llx\n", (long long)r.tickDivergencia,
+               (unsigned long long)r.obtenido, (unsigned long long)r.esperado);
+        return 1;
+    }
+    if (r.verificados != log.checkpoints.size()) { //alguno quedo fuera de los ticks grabados: archivo roto
+        printf("faltan checkpoints: el ultimo es del tick %u y se simularon %u\n", log.checkpoints.back().tick, r.ticks);
+        return 1;
+    }
+    return 0;
+}
+
+//--rewind-check: como el juego, una foto por tick en un HistorialSnapshots. Cada N ticks retrocede N
+//(cada retroceso tiene que caer en el tick anterior, con el hash que tuvo ese tick) y vuelve a jugar
+//esos N ticks comparando cada hash con el de la primera vez. Sale con 1 si algo no coincide.
+int CorrerRebobinado(const OpcionesHeadless& op) {
+    World world(256, 256 + 16 * op.bots);
+    world.setBroadphase(op.broadphase);
+    world.parametrosBot = op.bot;
+    JobSystem jobs(op.threads);
+    world.jobs = &jobs;
+    InputState sinTeclas;
+    HistorialSnapshots historial(op.rebobinar + 1);
+    MiVector<uint64_t> hashes; //hashes[t] = hashEstado() despues del tick t
+    hashes.reserve(op.maxTicks + 1);
+    int comprobaciones = 0;
+    for (int g = 0; g < op.games; g++) {
+        world.sembrar(op.seed + g);
+        world.reset(true, op.bots);
+        historial.clear();
+        historial.capturar(world, 0);
+        hashes.clear();
+        hashes.push_back(world.hashEstado());
+        int tick = 0;
+        while (tick < op.maxTicks && !world.victoria()) {
+            world.step(op.dt, sinTeclas);
+            tick++;
+            historial.capturar(world, (uint32_t)tick);
+            hashes.push_back(world.hashEstado());
+            if (tick % op.rebobinar != 0 && !world.victoria()) continue;
+
+            int atras = 0;
+            while (atras < op.rebobinar && historial.puedeRetroceder()) {
+                int t = (int)historial.retroceder(world);
+                atras++;
+                if (t != tick - atras || world.hashEstado() != hashes[t]) {
+                    printf("REBOBINADO MAL: partida %d, %d ticks antes del %d cae en el tick %d (hash %016llx, esperado %016llx)\n",
+                           g, atras, tick, t, (unsigned long long)world.hashEstado(), (unsigned long long)hashes[tick - atras]);
+                    return 1;
+                }
+            }
+            for (int t = tick - atras + 1; t <= tick; t++) {
+                world.step(op.dt, sinTeclas);
+                historial.capturar(world, (uint32_t)t);
+                if (world.hashEstado() != hashes[t]) {
+                    printf("DIVERGE tras rebobinar: partida %d, tick %d, hash %016llx, sin rebobinar %016llx\n", g, t,
+                           (unsigned long long)world.hashEstado(), (unsigned long long)hashes[t]);
+                    return 1;
+                }
+            }
+            comprobaciones++;
+        }
+    }
+    printf("rebobinado (%s): %d partidas, %d rebobinados de hasta %d ticks, todos caen y siguen igual\n",
+           world.broadphase->nombre(), op.games, comprobaciones, op.rebobinar);
+    return 0;
+}
+
+void ImprimirEstadistica(const char* nombre, const EstadisticaLote& e) {
+    printf("  %-10s %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f\n", nombre, e.min, e.p10, e.p50, e.p90, e.max, e.prom);
+}
+
+//--workers / --scaling: partidas independientes en paralelo; sale con 1 si el resultado cambia con los hilos
+int CorrerLoteHeadless(const OpcionesHeadless& op) {
+    ConfigLote c;
+    c.partidas = op.games; c.semilla = op.seed; c.maxTicks = op.maxTicks; c.dt = op.dt;
+    c.broadphase = op.broadphase; c.bots = op.bots; c.bot = op.bot;
+    int nucleos = (int)std::thread::hardware_concurrency();
+    int maxHilos = op.workers > 0 ? op.workers : (nucleos > 0 ? nucleos : 1);
+    MiVector<ResultadoPartida> resultados;
+
+    double segundos = CorrerLote(c, maxHilos, resultados);
+    ResumenLote r = ResumirLote(resultados);
+    printf("lote: %d partidas en %d hilos (%d nucleos), %.3f s -> %.1f partidas/s, %.0f ticks/s\n", r.partidas, maxHilos,
+           nucleos, segundos, r.partidas / segundos, r.ticks / segundos);
+    printf("bot: evasion %.0f px, cono %.0f grados, disparo %d%%, adelanto %.2f%s\n", op.bot.radioEvasion, op.bot.conoDisparo,
+           op.bot.probDisparo, op.bot.adelanto, op.bot.tiroEnLinea ? ", tiro en linea" : "");
+    printf("victorias: %d (%.1f%%)\n", r.victorias, 100.0 * r.victorias / (r.partidas > 0 ? r.partidas : 1));
+    printf("  %-10s %8s %8s %8s %8s %8s %8s\n", "", "min", "p10", "p50", "p90", "max", "prom");
+    ImprimirEstadistica("tiempo (s)", r.tiempo);
+    ImprimirEstadistica("balas", r.balas);
+    ImprimirEstadistica("perdidas", r.perdidas);
+    printf("huella: %016llx\n", (unsigned long long)r.huella);
+    if (!op.scaling) return 0;
+
+    //el mismo lote con 1, 2, 4... hilos: partidas/s, aceleracion contra 1 hilo y eficiencia por nucleo
+    printf("escalado: hilos  partidas/s  aceleracion  eficiencia\n");
+    double base = 0;
+    bool igual = true;
+    for (int h = 1; h <= maxHilos; h = (h * 2 <= maxHilos || h == maxHilos) ? h * 2 : maxHilos) {
+        double s = CorrerLote(c, h, resultados);
+        double porSegundo = c.partidas / s;
+        if (h == 1) base = porSegundo;
+        bool mismo = ResumirLote(resultados).huella == r.huella;
+        igual = igual && mismo;
+        printf("          %5d  %10.1f  %10.2fx  %9.0f%%%s\n", h, porSegundo, porSegundo / base,
+               100.0 * porSegundo / base / h, mismo ? "" : "  (HUELLA DISTINTA)");
+    }
+    return igual ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    OpcionesHeadless op = LeerOpciones(argc, argv);
+    if (op.replay) return CorrerReplay(op);
+    if (op.botCambiado && op.record) { fprintf(stderr, "las grabaciones no guardan --bot-*: no se pueden combinar con --record\n"); return 1; }
+    if (op.workers >= 0 || op.scaling) return CorrerLoteHeadless(op);
+    if (op.rebobinar > 0) return CorrerRebobinado(op);
+
+    World world(256, 256 + 16 * op.bots); //cada bot tiene unas 8 balas en vuelo
+    world.setBroadphase(op.broadphase);
+    world.parametrosBot = op.bot;
+    JobSystem jobs(op.threads);
+    world.jobs = &jobs;
+    Profiler profiler;
+    if (op.profile) world.profiler = &profiler; //sin --profile no se toma ni un reloj por tick
+    InputState sinTeclas; //el bot no usa teclado
+    long long ticksTotales = 0;
+    int victorias = 0;
+    double sumaTiempo = 0, sumaBalas = 0, sumaPerdidas = 0;
+    long long allocsBroadphase = 0; //veces que la broadphase pidio memoria
+    int maxAllocsFrame = 0;
+    long long candidatos = 0;
+    long long newsTrasPrimera = -1; //operator new contados desde que termino la primera partida
+    LoteRender lote;
+    SalidaConteo mock;
+    MiVector<Rect> nodos;
+    long long llamadasInmediatas = 0;
+    double segundosRender = 0;
+
+    auto inicio = std::chrono::steady_clock::now();
+    InputLog log;
+    log.cadaCheckpoint = op.checkpoint > 0 ? op.checkpoint : 0;
+    if (op.record) log.reservar(op.maxTicks);
+    for (int g = 0; g < op.games; g++) {
+        bool grabar = op.record && g == 0;
+        if (grabar) log.empezar(world, op.seed, true, op.bots);
+        else world.sembrar(op.seed + g);
+        world.reset(true, op.bots);
+        if (op.render && g == 0) { //el lote y el overlay al maximo de una vez, con los jugadores ya creados
+            nodos.reserve(MAX_NODOS_OVERLAY);
+            ReservarLote(lote, world, MAX_NODOS_OVERLAY);
+        }
+        int tick = 0;
+        while (tick < op.maxTicks && !world.victoria()) {
+            if (op.profile) profiler.beginFrame();
+            world.step(op.dt, sinTeclas);
+            if (op.profile) profiler.endFrame();
+            if (grabar) log.anotar(world, op.dt, sinTeclas);
+            if (op.render) {
+                auto t0 = std::chrono::steady_clock::now();
+                nodos.clear(); world.broadphase->getAllBounds(nodos);
+                ArmarLote(lote, world, &nodos, true);
+                lote.enviar(mock);
+                segundosRender += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                llamadasInmediatas += LlamadasInmediatas(world, &nodos, true);
+            }
+            int allocs = world.broadphase->getAllocaciones();
+            allocsBroadphase += allocs;
+            candidatos += world.broadphase->getCandidatos();
+            if (allocs > maxAllocsFrame) maxAllocsFrame = allocs;
+            tick++;
+        }
+        if (grabar) log.cerrar(world);
+        if (g == 0) newsTrasPrimera = g_news;
+        ticksTotales += tick;
+        if (world.victoria()) victorias++;
+        sumaTiempo += world.tiempoJuego;
+        sumaBalas += world.balasDisparadas;
+        sumaPerdidas += world.vecesPerdidas;
+    }
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    newsTrasPrimera = (newsTrasPrimera < 0) ? 0 : g_news - newsTrasPrimera;
+
+    int n = op.games > 0 ? op.games : 1;
+    printf("partidas: %d (victorias: %d)\n", op.games, victorias);
+    printf("ticks: %lld en %.3f s -> %.0f ticks/s, %.1f partidas/s\n",
+           ticksTotales, segundos, ticksTotales / segundos, op.games / segundos);
+    printf("promedios: tiempo %.2f s, balas %.1f, perdidas %.2f\n",
+           sumaTiempo / n, sumaBalas / n, sumaPerdidas / n);
+    printf("broadphase %s: %.1f candidatos/tick, %lld allocs en total, max %d en un frame\n", world.broadphase->nombre(),
+           (double)candidatos / (ticksTotales > 0 ? ticksTotales : 1), allocsBroadphase, maxAllocsFrame);
+    printf("pool asteroides: pico %zu, reciclados %zu, crecimientos %zu (capacidad %zu)\n", world.asteroides.stats.peak,
+           world.asteroides.stats.recycled, world.asteroides.stats.crecimientos, world.asteroides.capacity());
+    printf("pool balas: pico %zu, reciclados %zu, crecimientos %zu (capacidad %zu)\n", world.balas.stats.peak,
+           world.balas.stats.recycled, world.balas.stats.crecimientos, world.balas.capacity());
+    printf("operator new tras la primera partida: %lld\n", newsTrasPrimera);
+    if (op.render) {
+        double t = (double)(ticksTotales > 0 ? ticksTotales : 1);
+        printf("render (mock, con overlay y hitboxes): %.2f draw calls/tick (inmediato: %.1f), %.0f vertices/tick, armado %.2f us/tick\n",
+               mock.total.drawCalls / t, llamadasInmediatas / t, mock.total.vertices / t, segundosRender * 1e6 / t);
+    }
+
+    if (op.record) {
+        if (log.guardar(op.record)) printf("grabacion: %s (%zu ticks, %zu checkpoints)\n", op.record, log.ticks(), log.checkpoints.size());
+        else fprintf(stderr, "no se pudo escribir %s\n", op.record);
+    }
+    if (op.profile) ImprimirProfiler(op, profiler);
+    return 0;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define JOBS_SIN_HILOS 1 //web sin pthreads: todo corre en el hilo que llama
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#include "mivector.h"
+
+// ------------------------------------------
+// PARTE 3.5: SISTEMA DE TAREAS (WORK STEALING)
+// ------------------------------------------
+//parallelFor parte un rango en tareas y las reparte en una cola por hilo. Cada hilo saca de la suya
+//por atras y, cuando se queda sin trabajo, roba por adelante de la de otro. El hilo que llama
+//tambien trabaja y vuelve cuando no queda ninguna tarea pendiente.
+//
+//Las tareas no devuelven nada: cada una escribe en su propio lugar (indexado por numero de tarea) y
+//quien llama junta los resultados en orden de tarea, asi el resultado no depende de que hilo hizo que.
+//Una tarea es un puntero a funcion + contexto, no std::function: repartir no pide memoria.
+
+class JobSystem {
+private:
+    struct Tarea {
+        void (*fn)(void*, size_t, size_t, size_t); //(contexto, desde, hasta, numero de tarea)
+        void* ctx;
+        size_t desde, hasta, indice;
+    };
+
+    template <typename F>
+    static void Llamar(void* ctx, size_t desde, size_t hasta, size_t indice) { (*static_cast<F*>(ctx))(desde, hasta, indice); }
+
+#if defined(JOBS_SIN_HILOS)
+public:
+    explicit JobSystem(int = 0) {}
+    int hilos() const { return 1; }
+
+    template <typename F>
+    void parallelFor(size_t n, size_t porTarea, F&& f) {
+        if (porTarea == 0) porTarea = 1;
+        for (size_t d = 0, t = 0; d < n; d += porTarea, t++) f(d, d + porTarea < n ? d + porTarea : n, t);
+    }
+#else
+    struct Cola {
+        std::mutex m;
+        MiVector<Tarea> tareas;
+        size_t cabeza = 0; //las robadas salen por aqui; el duenio saca del final
+    };
+
+    MiVector<Cola*> colas; //una por hilo; la 0 es del que llama a parallelFor
+    MiVector<std::thread*> trabajadores;
+    std::mutex mDormir;
+    std::condition_variable despertar;
+    std::atomic<size_t> pendientes;
+    std::atomic<unsigned> generacion; //cambia con cada parallelFor para despertar a los que duermen
+    std::atomic<bool> terminar;
+
+    bool sacar(int h, Tarea& t) { //de la propia cola, por atras
+        Cola& c = *colas[h];
+        std::lock_guard<std::mutex> lock(c.m);
+        if (c.tareas.size() == c.cabeza) return false;
+        t = c.tareas.back();
+        c.tareas.pop_back();
+        if (c.tareas.size() == c.cabeza) { c.tareas.clear(); c.cabeza = 0; }
+        return true;
+    }
+
+    bool robar(int h, Tarea& t) { //de las demas, por adelante
+        int total = (int)colas.size();
+        for (int k = 1; k < total; k++) {
+            Cola& c = *colas[(h + k) % total];
+            std::lock_guard<std::mutex> lock(c.m);
+            if (c.tareas.size() == c.cabeza) continue;
+            t = c.tareas[c.cabeza++];
+            if (c.tareas.size() == c.cabeza) { c.tareas.clear(); c.cabeza = 0; }
+            return true;
+        }
+        return false;
+    }
+
+    bool correrUna(int h) {
+        Tarea t;
+        if (!sacar(h, t) && !robar(h, t)) return false;
+        t.fn(t.ctx, t.desde, t.hasta, t.indice);
+        pendientes.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+
+    void bucle(int h) {
+        unsigned vista = generacion.load();
+        while (!terminar.load()) {
+            if (correrUna(h)) continue;
+            std::unique_lock<std::mutex> lock(mDormir);
+            despertar.wait(lock, [&] { return terminar.load() || generacion.load() != vista; });
+            vista = generacion.load();
+        }
+    }
+
+public:
+    //hilos = 0 usa todos los nucleos; 1 no crea ningun hilo
+    explicit JobSystem(int hilos = 0) : pendientes(0), generacion(0), terminar(false) {
+        if (hilos <= 0) hilos = (int)std::thread::hardware_concurrency();
+        if (hilos <= 0) hilos = 1;
+        for (int h = 0; h < hilos; h++) colas.push_back(new Cola());
+        for (int h = 1; h < hilos; h++) trabajadores.push_back(new std::thread([this, h] { bucle(h); }));
+    }
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(mDormir);
+            terminar = true;
+        }
+        despertar.notify_all();
+        for (size_t i = 0; i < trabajadores.size(); i++) { trabajadores[i]->join(); delete trabajadores[i]; }
+        for (size_t i = 0; i < colas.size(); i++) delete colas[i];
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    int hilos() const { return (int)colas.size(); }
+
+    //f(desde, hasta, tarea) sobre [0, n) en tareas de porTarea elementos; vuelve cuando terminaron todas
+    template <typename F>
+    void parallelFor(size_t n, size_t porTarea, F&& f) {
+        typedef typename std::remove_reference<F>::type Fn;
+        if (porTarea == 0) porTarea = 1;
+        size_t cuantas = (n + porTarea - 1) / porTarea;
+        if (cuantas <= 1 || colas.size() == 1) {
+            for (size_t d = 0, t = 0; d < n; d += porTarea, t++) f(d, d + porTarea < n ? d + porTarea : n, t);
+            return;
+        }
+        pendientes.fetch_add(cuantas, std::memory_order_acq_rel);
+        int total = (int)colas.size();
+        for (size_t t = 0; t < cuantas; t++) { //las tareas contiguas quedan en la misma cola
+            size_t d = t * porTarea;
+            Tarea tarea = { &Llamar<Fn>, (void*)&f, d, d + porTarea < n ? d + porTarea : n, t };
+            Cola& c = *colas[(int)(t * total / cuantas)];
+            std::lock_guard<std::mutex> lock(c.m);
+            c.tareas.push_back(tarea);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mDormir);
+            generacion.fetch_add(1);
+        }
+        despertar.notify_all();
+        while (pendientes.load(std::memory_order_acquire) != 0) {
+            if (!correrUna(0)) std::this_thread::yield(); //las que quedan ya las tiene otro hilo
+        }
+    }
+#endif
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// ------------------------------------------------------------
+// PARTE 1: ESTRUCTURAS DE DATOS (CREACION DE VECTOR PROPIO)
+// ------------------------------------------------------------
+//La memoria se pide sin construir (operator new crudo) y los elementos se construyen en su lugar,
+//asi crecer no crea objetos por defecto para despues copiarlos encima: se mueven.
+//N > 0 agrega N lugares dentro del propio objeto (small buffer): mientras no se pasen de N
+//elementos no se toca el heap, util para listas cortas que se llenan y vacian cada frame.
+
+template <typename T, size_t N = 0>
+class MiVector {
+private:
+    T* datos; //puntero al arreglo (el buffer interno o uno del heap)
+    size_t capacidad; //capacidad total reservada
+    size_t cantidad; //cantidad elementos
+    alignas(T) unsigned char interno[N > 0 ? N * sizeof(T) : 1]; //small buffer
+
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "MiVector usa operator new sin alineacion extra");
+
+    T* bufferInterno() { return reinterpret_cast<T*>(interno); }
+    bool usaInterno() const { return N > 0 && datos == reinterpret_cast<const T*>(interno); }
+
+    void liberarBuffer() { //solo la memoria; los elementos ya deben estar destruidos
+        if (datos != nullptr && !usaInterno()) ::operator delete(datos);
+    }
+
+    void reallocate(size_t new_capacity) { //mueve los elementos a un buffer nuevo (new_capacity >= cantidad)
+        T* new_data = (N > 0 && new_capacity <= N) ? bufferInterno()
+                                                   : static_cast<T*>(::operator new(new_capacity * sizeof(T)));
+        if (new_data == datos) return;
+        for (size_t i = 0; i < cantidad; i++) {
+            new (&new_data[i]) T(std::move(datos[i])); //se mueve, no se copia
+            datos[i].~T();
+        }
+        liberarBuffer(); //libera memoria antigua
+        datos = new_data; //actualiza punteros
+        capacidad = (new_data == bufferInterno()) ? N : new_capacity;
+    }
+
+    //se queda con los elementos de other, que queda vacio; este ya tiene que estar vacio y sin buffer
+    //del heap (recien construido, o despues de clear() + liberarBuffer())
+    void tomarDe(MiVector& other) {
+        datos = N > 0 ? bufferInterno() : nullptr;
+        capacidad = N;
+        if (other.usaInterno()) { //el buffer interno no se puede robar, se mueven los elementos
+            for (size_t i = 0; i < other.cantidad; i++) new (&datos[i]) T(std::move(other.datos[i]));
+            cantidad = other.cantidad;
+            other.clear();
+        } else { //se roba el buffer del heap
+            datos = other.datos; capacidad = other.capacidad; cantidad = other.cantidad;
+            other.datos = N > 0 ? other.bufferInterno() : nullptr;
+            other.capacidad = N;
+            other.cantidad = 0;
+        }
+    }
+
+    void crecer() { //duplica capacidad si se llena (10 la primera vez, como antes)
+        reallocate(capacidad == 0 ? 10 : capacidad * 2);
+    }
+
+public:
+    MiVector() : datos(N > 0 ? bufferInterno() : nullptr), capacidad(N), cantidad(0) {}
+
+    ~MiVector() {
+        clear();
+        liberarBuffer();
+    }
+
+    MiVector(const MiVector& other) : MiVector() { //copia profunda (antes copiar el vector liberaba dos veces)
+        reserve(other.cantidad);
+        for (size_t i = 0; i < other.cantidad; i++) new (&datos[i]) T(other.datos[i]);
+        cantidad = other.cantidad;
+    }
+
+    MiVector(MiVector&& other) noexcept : MiVector() { tomarDe(other); }
+
+    MiVector& operator=(const MiVector& other) {
+        if (this == &other) return *this;
+        clear();
+        reserve(other.cantidad);
+        for (size_t i = 0; i < other.cantidad; i++) new (&datos[i]) T(other.datos[i]);
+        cantidad = other.cantidad;
+        return *this;
+    }
+
+    MiVector& operator=(MiVector&& other) noexcept {
+        if (this == &other) return *this;
+        clear();
+        liberarBuffer(); //primero se suelta lo propio, despues se toma lo de other
+        tomarDe(other);
+        return *this;
+    }
+
+    void push_back(const T& element) {
+        if (cantidad >= capacidad) {
+            T copia(element); //element podria vivir dentro de este mismo vector
+            crecer();
+            new (&datos[cantidad]) T(std::move(copia));
+        } else {
+            new (&datos[cantidad]) T(element); //se agrega elemento al final
+        }
+        cantidad++;
+    }
+
+    void push_back(T&& element) { emplace_back(std::move(element)); }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) { //construye el elemento directamente en su lugar
+        if (cantidad >= capacidad) {
+            T nuevo(std::forward<Args>(args)...);
+            crecer();
+            new (&datos[cantidad]) T(std::move(nuevo));
+        } else {
+            new (&datos[cantidad]) T(std::forward<Args>(args)...);
+        }
+        return datos[cantidad++];
+    }
+
+    void pop_back() { datos[--cantidad].~T(); }
+
+    void clear() { //se destruyen los elementos pero la memoria se conserva
+        for (size_t i = 0; i < cantidad; i++) datos[i].~T();
+        cantidad = 0;
+    }
+
+    T& operator[](size_t index) { return datos[index]; } //acceso por indice vect[i]
+    const T& operator[](size_t index) const { return datos[index]; }
+    T& back() { return datos[cantidad - 1]; }
+    const T& back() const { return datos[cantidad - 1]; }
+    T* data() { return datos; }
+    const T* data() const { return datos; }
+
+    size_t size() const { return cantidad; }
+    bool empty() const { return cantidad == 0; }
+    size_t capacity() const { return capacidad; }
+
+    void reserve(size_t new_capacity) { //reservar de una vez para no crecer en medio de un frame
+        if (new_capacity > capacidad) reallocate(new_capacity);
+    }
+
+    void shrink_to_fit() { //devuelve lo que sobra (vuelve al buffer interno si alcanza)
+        if (cantidad == 0 && N == 0) { //vacio: se suelta todo
+            liberarBuffer();
+            datos = nullptr;
+            capacidad = 0;
+        } else if (cantidad < capacidad) {
+            reallocate(cantidad);
+        }
+    }
+
+    //Como std::vector: los nuevos se construyen por defecto. Si no entra crece al menos al doble, asi
+    //una serie de resize de a poco (n, n + 1, ...) copia O(n) en total y no O(n^2).
+    void resize(size_t n) {
+        if (n > capacidad) reallocate(n > 2 * capacidad ? n : 2 * capacidad);
+        for (size_t i = cantidad; i < n; i++) new (&datos[i]) T();
+        for (size_t i = n; i < cantidad; i++) datos[i].~T();
+        cantidad = n;
+    }
+
+    void erase(size_t index) { //Se elimina elemento con indice especifico, conservando el orden
+        if (index >= cantidad) return;
+        for (size_t i = index; i < cantidad - 1; i++) {
+            datos[i] = std::move(datos[i + 1]); //Se mueven todos los elementos posteriores; O(n)
+        }
+        pop_back();
+    }
+
+    void erase_unordered(size_t index) { //O(1): el ultimo ocupa el hueco (no conserva el orden)
+        if (index >= cantidad) return;
+        if (index != cantidad - 1) datos[index] = std::move(datos[cantidad - 1]);
+        pop_back();
+    }
+
+    //hacemos compatibles los iteradores (solo por si acaso, para poder usar: for(auto& x : lista))
+    T* begin() { return datos; }
+    T* end() { return datos + cantidad; }
+    const T* begin() const { return datos; }
+    const T* end() const { return datos + cantidad; }
+};
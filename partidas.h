@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "mivector.h"
+#include "world.h"
+
+// ------------------------------------------
+// PARTE 9: PARTIDAS EN LOTE
+// ------------------------------------------
+//Miles de partidas independientes del bot repartidas entre hilos, para evaluar cambios en ParametrosBot
+//con numeros en vez de mirando partidas. Cada hilo arma su propio World (pools, broadphase y Rng) y va
+//tomando la siguiente partida de un contador atomico, asi las partidas largas no dejan hilos parados.
+//Lo unico compartido es ese contador y el arreglo de resultados, donde cada partida escribe solo en su
+//lugar. La partida g usa siempre la semilla semilla + g y el World no tiene estado global, asi que los
+//resultados no dependen de cuantos hilos hay ni de que hilo corrio cada partida.
+
+struct ConfigLote {
+    int partidas = 1000;
+    unsigned semilla = 1;
+    int maxTicks = 60 * 120;
+    float dt = 1.0f / 60.0f;
+    TipoBroadphase broadphase = BP_QUADTREE;
+    int bots = 1;
+    ParametrosBot bot;
+};
+
+struct ResultadoPartida {
+    float tiempo; //tiempoJuego al terminar
+    int balas, perdidas, ticks;
+    bool victoria;
+    uint64_t hash; //hashEstado() final, para comprobar que el reparto no cambia nada
+};
+
+//min, percentiles, max y promedio de una stat sobre todas las partidas
+struct EstadisticaLote {
+    float min, p10, p50, p90, max, prom;
+};
+
+inline EstadisticaLote Resumir(MiVector<float>& v) { //ordena v
+    EstadisticaLote e = {};
+    if (v.empty()) return e;
+    std::sort(v.begin(), v.end());
+    double suma = 0;
+    for (size_t i = 0; i < v.size(); i++) suma += v[i];
+    auto pct = [&](int p) { return v[(v.size() - 1) * p / 100]; };
+    e.min = v[0]; e.p10 = pct(10); e.p50 = pct(50); e.p90 = pct(90); e.max = v[v.size() - 1];
+    e.prom = (float)(suma / v.size());
+    return e;
+}
+
+struct ResumenLote {
+    int partidas = 0, victorias = 0;
+    long long ticks = 0;
+    EstadisticaLote tiempo, balas, perdidas;
+    uint64_t huella = 0; //los hashes finales en orden de partida; igual con cualquier cantidad de hilos
+};
+
+//Corre las partidas de c en 'hilos' hilos (0 = todos los nucleos) y deja cada resultado en su indice de
+//'out'. Devuelve los segundos de reloj que tardo.
+inline double CorrerLote(const ConfigLote& c, int hilos, MiVector<ResultadoPartida>& out) {
+    if (hilos <= 0) hilos = (int)std::thread::hardware_concurrency();
+    if (hilos <= 0) hilos = 1;
+    out.resize(c.partidas > 0 ? c.partidas : 0);
+    std::atomic<int> siguiente(0);
+
+    auto trabajar = [&]() {
+        World world(256, 256 + 16 * c.bots); //uno por hilo: se reutiliza entre sus partidas sin pedir memoria
+        world.setBroadphase(c.broadphase);
+        world.parametrosBot = c.bot;
+        InputState sinTeclas;
+        for (int g = siguiente.fetch_add(1); g < c.partidas; g = siguiente.fetch_add(1)) {
+            world.sembrar(c.semilla + g);
+            world.reset(true, c.bots);
+            int tick = 0;
+            while (tick < c.maxTicks && !world.victoria()) { world.step(c.dt, sinTeclas); tick++; }
+            out[g] = { world.tiempoJuego, world.balasDisparadas, world.vecesPerdidas, tick, world.victoria(), world.hashEstado() };
+        }
+    };
+
+    auto inicio = std::chrono::steady_clock::now();
+    MiVector<std::thread*> trabajadores;
+    for (int h = 1; h < hilos; h++) trabajadores.push_back(new std::thread(trabajar));
+    trabajar(); //el que llama tambien corre partidas
+    for (size_t h = 0; h < trabajadores.size(); h++) { trabajadores[h]->join(); delete trabajadores[h]; }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+inline ResumenLote ResumirLote(const MiVector<ResultadoPartida>& r) {
+    ResumenLote s;
+    MiVector<float> tiempo, balas, perdidas;
+    tiempo.reserve(r.size()); balas.reserve(r.size()); perdidas.reserve(r.size());
+    HashFNV h;
+    for (size_t g = 0; g < r.size(); g++) {
+        s.victorias += r[g].victoria ? 1 : 0;
+        s.ticks += r[g].ticks;
+        tiempo.push_back(r[g].tiempo);
+        balas.push_back((float)r[g].balas);
+        perdidas.push_back((float)r[g].perdidas);
+        h.valor(r[g].hash);
+    }
+    s.partidas = (int)r.size();
+    s.tiempo = Resumir(tiempo); s.balas = Resumir(balas); s.perdidas = Resumir(perdidas);
+    s.huella = h.h;
+    return s;
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+// ------------------------------------------
+// PROFILER DE FRAMES
+// ------------------------------------------
+//Cronometros por fase del loop (update, victoria, broadphase, colisiones, limpieza, render) y
+//contadores del frame. Cada frame terminado se copia a un ring buffer de tamanio fijo (un solo
+//escritor). Cada slot lleva un numero de secuencia que el escritor marca antes y despues de copiar
+//el frame; el lector lo revisa antes y despues de su copia y descarta el slot si cambio, asi que se
+//puede leer desde otro hilo sin locks aunque el escritor le de la vuelta al anillo mientras tanto.
+//No hay profiler global: cada World apunta al suyo (o a ninguno, y entonces no se mide nada).
+
+enum FaseProfiler { FASE_UPDATE, FASE_VICTORIA, FASE_BROADPHASE, FASE_COLISIONES, FASE_LIMPIEZA, FASE_RENDER, FASE_TOTAL };
+
+inline const char* NombreFase(int f) {
+    static const char* nombres[FASE_TOTAL] = { "update", "victoria", "broadphase", "colisiones", "limpieza", "render" };
+    return nombres[f];
+}
+
+enum ContadorProfiler { CONT_ENTIDADES, CONT_NODOS, CONT_PARES, CONT_TESTS, CONT_DRAWCALLS, CONT_VERTICES, CONT_TOTAL };
+
+inline const char* NombreContador(int c) {
+    static const char* nombres[CONT_TOTAL] = { "entidades", "nodos", "pares", "tests_narrowphase", "draw_calls", "vertices" };
+    return nombres[c];
+}
+
+struct FrameProfile {
+    double inicioUs; //cuando empezo el frame (us desde que se creo el profiler)
+    float inicioFaseUs[FASE_TOTAL]; //offset de cada fase dentro del frame
+    float duracionUs[FASE_TOTAL]; //0 si la fase no corrio en este frame
+    int contadores[CONT_TOTAL];
+};
+
+struct ResumenFase { float minUs, avgUs, p99Us; };
+
+class Profiler {
+public:
+    static const int CAPACIDAD = 512; //frames que se guardan (~8 s a 60 FPS)
+
+private:
+    typedef std::chrono::steady_clock Reloj;
+    Reloj::time_point origen;
+    FrameProfile frames[CAPACIDAD];
+    std::atomic<unsigned long long> escritos; //frames publicados en total; el slot es escritos % CAPACIDAD
+    //secuencia de cada slot: impar mientras se escribe; al terminar el frame i vale 2 * (i / CAPACIDAD) + 2
+    std::atomic<unsigned long long> secuencia[CAPACIDAD];
+    FrameProfile actual; //el frame que se esta midiendo
+    double abierta[FASE_TOTAL]; //inicio de las fases abiertas con iniciar()
+
+    double ahoraUs() const { return std::chrono::duration<double, std::micro>(Reloj::now() - origen).count(); }
+
+    //copia el frame i a out si el slot todavia lo tiene entero; false si el escritor ya lo piso o lo esta pisando
+    bool leerFrame(unsigned long long i, FrameProfile& out) const {
+        const std::atomic<unsigned long long>& seq = secuencia[i % CAPACIDAD];
+        unsigned long long esperada = 2 * (i / CAPACIDAD) + 2;
+        if (seq.load(std::memory_order_acquire) != esperada) return false;
+        out = frames[i % CAPACIDAD];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return seq.load(std::memory_order_relaxed) == esperada;
+    }
+
+    //copia los ultimos frames publicados; los que el escritor piso mientras se copiaban se saltan
+    int ultimos(FrameProfile* out, int maximo) const {
+        unsigned long long n = escritos.load(std::memory_order_acquire);
+        unsigned long long desde = n > (unsigned long long)CAPACIDAD ? n - CAPACIDAD : 0;
+        if (n - desde > (unsigned long long)maximo) desde = n - maximo;
+        int k = 0;
+        for (unsigned long long i = desde; i < n; i++)
+            if (leerFrame(i, out[k])) k++;
+        return k;
+    }
+
+public:
+    Profiler() : origen(Reloj::now()), escritos(0) {
+        for (int f = 0; f < FASE_TOTAL; f++) abierta[f] = 0;
+        for (int i = 0; i < CAPACIDAD; i++) secuencia[i].store(0, std::memory_order_relaxed);
+        beginFrame();
+    }
+
+    void beginFrame() {
+        actual = FrameProfile{};
+        actual.inicioUs = ahoraUs();
+    }
+
+    void endFrame() { //publica el frame en el anillo
+        unsigned long long n = escritos.load(std::memory_order_relaxed);
+        std::atomic<unsigned long long>& seq = secuencia[n % CAPACIDAD];
+        seq.store(2 * (n / CAPACIDAD) + 1, std::memory_order_relaxed); //impar: slot a medio escribir
+        std::atomic_thread_fence(std::memory_order_release);
+        frames[n % CAPACIDAD] = actual;
+        seq.store(2 * (n / CAPACIDAD) + 2, std::memory_order_release);
+        escritos.store(n + 1, std::memory_order_release);
+    }
+
+    void agregarFase(FaseProfiler f, double inicioUs, double finUs) {
+        if (actual.duracionUs[f] == 0) actual.inicioFaseUs[f] = (float)(inicioUs - actual.inicioUs);
+        actual.duracionUs[f] += (float)(finUs - inicioUs); //si una fase corre varias veces en el frame, se suma
+    }
+
+    //para fases que no caben en un bloque (el render del juego termina antes de EndDrawing)
+    void iniciar(FaseProfiler f) { abierta[f] = ahoraUs(); }
+    void terminar(FaseProfiler f) { agregarFase(f, abierta[f], ahoraUs()); }
+
+    void contador(ContadorProfiler c, int valor) { actual.contadores[c] = valor; }
+
+    //cronometro de alcance: mide desde que se crea hasta que sale del bloque
+    class Scope {
+        Profiler* p;
+        FaseProfiler fase;
+        double inicio;
+    public:
+        Scope(Profiler* _p, FaseProfiler _fase) : p(_p), fase(_fase), inicio(_p ? _p->ahoraUs() : 0) {}
+        ~Scope() { if (p) p->agregarFase(fase, inicio, p->ahoraUs()); }
+    };
+
+    unsigned long long framesEscritos() const { return escritos.load(std::memory_order_acquire); }
+
+    ResumenFase resumen(FaseProfiler f) const { //min/promedio/p99 de los frames guardados
+        static thread_local FrameProfile copia[CAPACIDAD];
+        static thread_local float valores[CAPACIDAD];
+        int n = ultimos(copia, CAPACIDAD);
+        ResumenFase r = { 0, 0, 0 };
+        if (n == 0) return r;
+        double suma = 0;
+        for (int i = 0; i < n; i++) { valores[i] = copia[i].duracionUs[f]; suma += valores[i]; }
+        std::sort(valores, valores + n);
+        r.minUs = valores[0];
+        r.avgUs = (float)(suma / n);
+        r.p99Us = valores[(n - 1) * 99 / 100];
+        return r;
+    }
+
+    int ultimoContador(ContadorProfiler c) const {
+        FrameProfile f;
+        for (;;) { //si el escritor pisa el slot mientras se lee, se vuelve a probar con el frame mas nuevo
+            unsigned long long n = escritos.load(std::memory_order_acquire);
+            if (n == 0) return 0;
+            if (leerFrame(n - 1, f)) return f.contadores[c];
+        }
+    }
+
+    bool exportarCSV(const char* ruta) const { //un frame por fila: duraciones en us y contadores
+        static thread_local FrameProfile copia[CAPACIDAD];
+        int n = ultimos(copia, CAPACIDAD);
+        FILE* f = fopen(ruta, "w");
+        if (!f) return false;
+        fprintf(f, "inicio_us");
+        for (int k = 0; k < FASE_TOTAL; k++) fprintf(f, ",%s_us", NombreFase(k));
+        for (int k = 0; k < CONT_TOTAL; k++) fprintf(f, ",%s", NombreContador(k));
+        fprintf(f, "\n");
+        for (int i = 0; i < n; i++) {
+            fprintf(f, "%.1f", copia[i].inicioUs);
+            for (int k = 0; k < FASE_TOTAL; k++) fprintf(f, ",%.2f", copia[i].duracionUs[k]);
+            for (int k = 0; k < CONT_TOTAL; k++) fprintf(f, ",%d", copia[i].contadores[k]);
+            fprintf(f, "\n");
+        }
+        fclose(f);
+        return true;
+    }
+
+    bool exportarChromeTrace(const char* ruta) const { //se abre en chrome://tracing o en Perfetto
+        static thread_local FrameProfile copia[CAPACIDAD];
+        int n = ultimos(copia, CAPACIDAD);
+        FILE* f = fopen(ruta, "w");
+        if (!f) return false;
+        fprintf(f, "{\"traceEvents\":[\n");
+        bool primero = true;
+        for (int i = 0; i < n; i++) {
+            const FrameProfile& fr = copia[i];
+            for (int k = 0; k < FASE_TOTAL; k++) {
+                if (fr.duracionUs[k] <= 0) continue;
+                fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.1f,\"dur\":%.2f}",
+                        primero ? "" : ",\n", NombreFase(k), fr.inicioUs + fr.inicioFaseUs[k], fr.duracionUs[k]);
+                primero = false;
+            }
+            fprintf(f, "%s{\"name\":\"contadores\",\"ph\":\"C\",\"pid\":1,\"ts\":%.1f,\"args\":{", primero ? "" : ",\n", fr.inicioUs);
+            for (int k = 0; k < CONT_TOTAL; k++) fprintf(f, "%s\"%s\":%d", k ? "," : "", NombreContador(k), fr.contadores[k]);
+            fprintf(f, "}}");
+            primero = false;
+        }
+        fprintf(f, "\n]}\n");
+        fclose(f);
+        return true;
+    }
+};
@@ -0,0 +1,396 @@
+#pragma once
+
+#include "mivector.h"
+#include "geometria.h"
+#include "broadphase.h"
+
+// ------------------------------------------
+// PARTE 3.1: QUADTREE
+// -------------------------------------------
+
+//Los nodos viven en un arreglo plano y se referencian por indice (no hay new/delete por nodo).
+//Los objetos de todos los nodos comparten un solo arreglo de items; cada nodo tiene una lista
+//doblemente enlazada por indices dentro de ese arreglo. clear() solo reinicia los contadores, la
+//memoria se reutiliza, asi que reconstruir el arbol no pide memoria al heap.
+//
+//Ademas el arbol es incremental: insert() devuelve un id estable para el objeto, y con move()/remove()
+//se actualiza solo lo que cambio. Un objeto que sigue dentro de su nodo no se toca; uno que cruza el
+//borde del nodo se reinserta, y los subarboles que quedan con pocos objetos se vuelven a fusionar.
+//
+//Capacidad por hoja, profundidad maxima y tipo de coordenada de los nodos son parametros de plantilla:
+//son constantes en getIndex()/insertSlot() y no ocupan lugar en el objeto. Con Coord = int los cortes
+//caen en pixeles enteros. 'bench --autotune' compara combinaciones sobre escenas grabadas.
+template <typename Coord>
+struct QuadNode {
+    Coord x0, y0, x1, y1; //area que cubre el nodo
+    int level; //nivel profundidad en arbol; -1 = nodo libre (su bloque se puede reutilizar)
+    int parent; //-1 = raiz
+    int firstChild; //indice del primer hijo (los 4 son consecutivos: NE, NW, SW, SE); -1 = hoja
+    int firstItem; //cabeza de la lista de objetos del nodo; -1 = vacia
+    int itemCount; //objetos guardados en este nodo
+    int subtreeCount; //objetos en este nodo y todos sus descendientes (para saber cuando fusionar)
+};
+
+template <int MAX_OBJECTS = 4, int MAX_LEVELS = 5, typename Coord = float>
+class QuadtreeT : public Broadphase {
+private:
+    //MAX_OBJECTS: maximo de objetos antes de dividir. MAX_LEVELS: profundidad maxima; evita recursividad infinita
+    static_assert(MAX_OBJECTS > 0 && MAX_LEVELS >= 0, "parametros de quadtree invalidos");
+    typedef QuadNode<Coord> Nodo;
+    MiVector<Nodo> nodes; //nodes[0] = raiz
+    MiVector<int> freeBlocks; //bloques de 4 hijos liberados al fusionar, listos para reutilizar
+    MiVector<BroadItem> items; //objetos de todos los nodos (el indice es el id del objeto)
+    MiVector<int> nextItem, prevItem; //lista del nodo; en items libres nextItem encadena la lista libre
+    MiVector<int> itemNode; //nodo donde esta cada item; -1 = libre
+    int freeItem; //cabeza de la lista de ids libres
+    int liveNodes;
+    int allocaciones; //veces que algun arreglo tuvo que crecer desde resetContadores()
+    int reinserciones; //objetos que cambiaron de nodo desde resetContadores()
+
+    template <typename V, typename T>
+    void pushContado(V& vec, const T& value) { //push_back que anota si hubo que pedir memoria
+        if (vec.size() >= vec.capacity()) allocaciones++;
+        vec.push_back(value);
+    }
+
+    static Coord mitad(Coord a, Coord b) { return a + (b - a) / 2; }
+
+    void initNode(int n, int level, int parent, Coord x0, Coord y0, Coord x1, Coord y1) {
+        nodes[n] = Nodo{ x0, y0, x1, y1, level, parent, -1, -1, 0, 0 };
+    }
+
+    Rect boundsNodo(int n) const {
+        const Nodo& q = nodes[n];
+        return { (float)q.x0, (float)q.y0, (float)(q.x1 - q.x0), (float)(q.y1 - q.y0) };
+    }
+
+    //Area que cubre el nodo para ubicar y buscar: los lados que caen sobre el borde de la raiz quedan
+    //abiertos hacia afuera. Asi lo que asoma fuera de pantalla (asteroides entrando o saliendo, una bala
+    //en el ultimo pixel) baja al nodo del borde que le toca en vez de quedarse en la raiz, donde lo
+    //recorren todas las consultas y todos los pares. boundsNodo() sigue siendo el cuadrado real (debug).
+    void area(int n, float& x0, float& y0, float& x1, float& y1) const {
+        const float LEJOS = 1e30f;
+        const Nodo& q = nodes[n];
+        const Nodo& raiz = nodes[0];
+        x0 = q.x0 <= raiz.x0 ? -LEJOS : (float)q.x0;
+        y0 = q.y0 <= raiz.y0 ? -LEJOS : (float)q.y0;
+        x1 = q.x1 >= raiz.x1 ? LEJOS : (float)q.x1;
+        y1 = q.y1 >= raiz.y1 ? LEJOS : (float)q.y1;
+    }
+
+    bool contiene(int n, const Rect& r) const {
+        float x0, y0, x1, y1;
+        area(n, x0, y0, x1, y1);
+        return r.x >= x0 && r.x + r.width <= x1 && r.y >= y0 && r.y + r.height <= y1;
+    }
+
+    bool toca(int n, const Rect& r) const {
+        float x0, y0, x1, y1;
+        area(n, x0, y0, x1, y1);
+        return r.x < x1 && r.x + r.width > x0 && r.y < y1 && r.y + r.height > y0;
+    }
+
+    void link(int n, int slot) { //agrega el item a la lista del nodo n
+        int head = nodes[n].firstItem;
+        nextItem[slot] = head;
+        prevItem[slot] = -1;
+        if (head != -1) prevItem[head] = slot;
+        nodes[n].firstItem = slot;
+        nodes[n].itemCount++;
+        itemNode[slot] = n;
+        for (int a = n; a != -1; a = nodes[a].parent) nodes[a].subtreeCount++;
+    }
+
+    void unlink(int slot) { //lo saca de la lista de su nodo en O(1)
+        int n = itemNode[slot];
+        int prev = prevItem[slot], next = nextItem[slot];
+        if (prev != -1) nextItem[prev] = next; else nodes[n].firstItem = next;
+        if (next != -1) prevItem[next] = prev;
+        nodes[n].itemCount--;
+        for (int a = n; a != -1; a = nodes[a].parent) nodes[a].subtreeCount--;
+    }
+
+    void freeChildren(int n) { //libera recursivamente los hijos de n (deben estar vacios)
+        int first = nodes[n].firstChild;
+        if (first == -1) return;
+        for (int i = 0; i < 4; i++) {
+            freeChildren(first + i);
+            nodes[first + i].level = -1;
+        }
+        liveNodes -= 4;
+        pushContado(freeBlocks, first);
+        nodes[n].firstChild = -1;
+    }
+
+    void absorb(int n, int c) { //mueve al nodo n todos los objetos del subarbol c
+        int it = nodes[c].firstItem;
+        while (it != -1) {
+            int next = nextItem[it];
+            unlink(it);
+            link(n, it);
+            it = next;
+        }
+        if (nodes[c].firstChild != -1) {
+            for (int i = 0; i < 4; i++) absorb(n, nodes[c].firstChild + i);
+        }
+    }
+
+    void merge(int n) { //sube desde n y fusiona el ancestro mas alto que ya no necesita estar dividido
+        int target = -1;
+        for (int a = n; a != -1; a = nodes[a].parent) {
+            if (nodes[a].firstChild != -1 && nodes[a].subtreeCount <= MAX_OBJECTS) target = a;
+        }
+        if (target == -1) return;
+        for (int i = 0; i < 4; i++) absorb(target, nodes[target].firstChild + i);
+        freeChildren(target);
+    }
+
+public:
+    const char* nombre() const override { return "quadtree"; }
+
+    QuadtreeT(int pLevel, Rect pBounds) : freeItem(-1), liveNodes(1), allocaciones(0), reinserciones(0) {
+        int maxNodes = 0;
+        for (int l = 0, porNivel = 1; l <= MAX_LEVELS; l++, porNivel *= 4) maxNodes += porNivel;
+        nodes.reserve(maxNodes); //los bloques liberados se reutilizan, asi que el arreglo de nodos nunca crece
+        nodes.push_back(Nodo{});
+        initNode(0, pLevel, -1, (Coord)pBounds.x, (Coord)pBounds.y, (Coord)(pBounds.x + pBounds.width), (Coord)(pBounds.y + pBounds.height));
+    }
+
+    void clear() override { //se deja solo la raiz; la capacidad de los arreglos se conserva
+        Nodo root = nodes[0];
+        nodes.clear();
+        freeBlocks.clear();
+        items.clear();
+        nextItem.clear();
+        prevItem.clear();
+        itemNode.clear();
+        freeItem = -1;
+        liveNodes = 1;
+        nodes.push_back(Nodo{});
+        initNode(0, root.level, -1, root.x0, root.y0, root.x1, root.y1);
+    }
+
+    void reservar(size_t n) override {
+        items.reserve(n); nextItem.reserve(n); prevItem.reserve(n); itemNode.reserve(n);
+        freeBlocks.reserve(nodes.capacity() / 4);
+    }
+
+    void resetContadores() override { Broadphase::resetContadores(); allocaciones = 0; reinserciones = 0; }
+    int getAllocaciones() const override { return allocaciones; }
+    int getReinserciones() const override { return reinserciones; }
+    int nodeCount() const override { return liveNodes; }
+
+    void split(int n) { //dividir el nodo en 4 cuadrantes
+        Nodo b = nodes[n];
+        int level = b.level;
+        Coord mx = mitad(b.x0, b.x1), my = mitad(b.y0, b.y1);
+        int first;
+        if (!freeBlocks.empty()) { //reutiliza un bloque liberado por una fusion
+            first = freeBlocks.back();
+            freeBlocks.pop_back();
+        } else {
+            first = (int)nodes.size();
+            for (int i = 0; i < 4; i++) pushContado(nodes, Nodo{});
+        }
+        initNode(first + 0, level + 1, n, mx, b.y0, b.x1, my); //NE
+        initNode(first + 1, level + 1, n, b.x0, b.y0, mx, my); //NW
+        initNode(first + 2, level + 1, n, b.x0, my, mx, b.y1); //SW
+        initNode(first + 3, level + 1, n, mx, my, b.x1, b.y1); //SE
+        nodes[n].firstChild = first;
+        liveNodes += 4;
+    }
+
+    int getIndex(int n, const Rect& r) const {//determina en que cuadrante encaja la caja (-1 si no encaja en ninguno y debe quedarse en el padre)
+        const Nodo& q = nodes[n];
+        float mx = (float)mitad(q.x0, q.x1), my = (float)mitad(q.y0, q.y1);
+        float x0, y0, x1, y1;
+        area(n, x0, y0, x1, y1); //los hijos del borde heredan los lados abiertos
+        //en vez de armar los 4 rectangulos hijos alcanza con comparar contra las lineas de corte
+        bool arriba = r.y >= y0 && r.y + r.height <= my;
+        bool abajo = r.y >= my && r.y + r.height <= y1;
+        bool izq = r.x >= x0 && r.x + r.width <= mx;
+        bool der = r.x >= mx && r.x + r.width <= x1;
+
+        if (arriba && der) return 0; //NE
+        if (arriba && izq) return 1; //NW
+        if (abajo && izq) return 2; //SW
+        if (abajo && der) return 3; //SE
+
+        return -1; // no cabe completamente en ningun hijo
+    }
+
+    int insert(const BroadItem& item) override {
+        int slot;
+        if (freeItem != -1) { //reutiliza un id libre
+            slot = freeItem;
+            freeItem = nextItem[slot];
+            items[slot] = item;
+        } else {
+            slot = (int)items.size();
+            pushContado(items, item);
+            pushContado(nextItem, -1);
+            pushContado(prevItem, -1);
+            pushContado(itemNode, -1);
+        }
+        insertSlot(0, slot);
+        return slot;
+    }
+
+    void insertSlot(int n, int slot) {
+        const Rect& r = items[slot].bounds;
+        if (nodes[n].firstChild != -1) { //Si no es hoja, intento insert en uno de lso hijos
+            int index = getIndex(n, r);
+            if (index != -1) { insertSlot(nodes[n].firstChild + index, slot); return; } //Si cabe en hijo, se inserta ahi
+        }
+        link(n, slot); //Si no cabe en el hijo, guardar en el nodo actual
+        if (nodes[n].itemCount > MAX_OBJECTS && nodes[n].level < MAX_LEVELS) {//verifico si excedi la capacidad y si puedo dividir mas
+            if (nodes[n].firstChild == -1) split(n); //Si no tiene hijos, se crean
+            int it = nodes[n].firstItem;
+            while (it != -1) { //redistribuir las entidades a los nuevos hijos si es posible
+                int next = nextItem[it];
+                int index = getIndex(n, items[it].bounds);
+                if (index != -1) { //si se puede, mover al hijo
+                    unlink(it);
+                    insertSlot(nodes[n].firstChild + index, it);
+                } //si no cabe en hijos, se queda aca
+                it = next;
+            }
+        }
+    }
+
+    void move(int id, const Rect& newBounds) override { //actualiza la caja; solo reinserta si salio de su nodo
+        items[id].bounds = newBounds;
+        int n = itemNode[id];
+        bool dentro = contiene(n, newBounds); //la raiz (y los lados del borde) no tienen limite hacia afuera
+        if (dentro && (nodes[n].firstChild == -1 || getIndex(n, newBounds) == -1)) return; //sigue en su lugar
+        reinserciones++;
+        unlink(id);
+        insertSlot(dentro ? n : 0, id); //si aun esta dentro baja desde su nodo, si no desde la raiz
+        merge(n);
+    }
+
+    void remove(int id) override {
+        int n = itemNode[id];
+        unlink(id);
+        itemNode[id] = -1;
+        nextItem[id] = freeItem; //el id queda libre para el proximo insert
+        freeItem = id;
+        merge(n);
+    }
+
+    void setRef(int id, EntityRef ref) override { items[id].ref = ref; }
+
+    //Consulta por rectangulo: los objetos de cada nodo se prueban contra r y solo se baja a los hijos
+    //cuyo area toca r y que tienen algo (antes un objeto sobre una linea de corte arrastraba los 4
+    //subarboles enteros a la lista). La poda usa el area con los lados del borde abiertos (ver area()).
+    bool query(const Rect& r, Visitante visita) override { return queryNode(0, r, visita); }
+
+    bool queryNode(int n, const Rect& r, const Visitante& visita) const {
+        for (int it = nodes[n].firstItem; it != -1; it = nextItem[it]) {
+            if (SeSolapan(items[it].bounds, r) && !visita(items[it])) return false;
+        }
+        int child = nodes[n].firstChild;
+        if (child == -1) return true;
+        for (int i = 0; i < 4; i++) {
+            if (nodes[child + i].subtreeCount == 0 || !toca(child + i, r)) continue; //poda
+            if (!queryNode(child + i, r, visita)) return false;
+        }
+        return true;
+    }
+
+    //Busqueda en profundidad que baja primero al hijo mas cercano y poda los que ya no pueden mejorar
+    //el k-esimo. Vale porque lo que guarda un hijo cabe entero en su area (abierta en los bordes).
+    int nearest(float px, float py, TipoEntidad tipo, int k, Vecino* out) override {
+        int n = 0;
+        if (k > 0) nearestNode(0, px, py, tipo, k, out, n);
+        return n;
+    }
+
+    void nearestNode(int nodo, float px, float py, TipoEntidad tipo, int k, Vecino* out, int& n) const {
+        for (int it = nodes[nodo].firstItem; it != -1; it = nextItem[it]) {
+            if (items[it].ref.tipo == tipo) AgregarVecino(out, n, k, items[it].ref, Dist2Centro(items[it].bounds, px, py));
+        }
+        int child = nodes[nodo].firstChild;
+        if (child == -1) return;
+        int orden[4]; float cota[4]; int m = 0;
+        for (int i = 0; i < 4; i++) { //hijos con algo, ordenados por distancia a su area
+            if (nodes[child + i].subtreeCount == 0) continue;
+            float x0, y0, x1, y1;
+            area(child + i, x0, y0, x1, y1);
+            float d = Dist2Caja(x0, y0, x1, y1, px, py);
+            int j = m++;
+            while (j > 0 && cota[j - 1] > d) { cota[j] = cota[j - 1]; orden[j] = orden[j - 1]; j--; }
+            cota[j] = d; orden[j] = child + i;
+        }
+        for (int i = 0; i < m; i++) {
+            if (n == k && cota[i] > out[k - 1].dist2) break; //los que siguen estan mas lejos todavia
+            nearestNode(orden[i], px, py, tipo, k, out, n);
+        }
+    }
+
+    //Igual que nearest pero ordenando los hijos por donde el rayo entra en cada uno.
+    bool raycast(float ox, float oy, float dx, float dy, float tMax, TipoEntidad tipo, Impacto& hit) override {
+        bool hay = false;
+        raycastNode(0, ox, oy, 1.0f / dx, 1.0f / dy, tMax, tipo, hit, hay);
+        return hay;
+    }
+
+    void raycastNode(int nodo, float ox, float oy, float invX, float invY, float tMax, TipoEntidad tipo, Impacto& hit, bool& hay) const {
+        float t;
+        for (int it = nodes[nodo].firstItem; it != -1; it = nextItem[it]) {
+            if (items[it].ref.tipo == tipo && RayoCaja(ox, oy, invX, invY, items[it].bounds, tMax, t)) MejorImpacto(hit, hay, items[it].ref, t);
+        }
+        int child = nodes[nodo].firstChild;
+        if (child == -1) return;
+        int orden[4]; float entrada[4]; int m = 0;
+        for (int i = 0; i < 4; i++) {
+            if (nodes[child + i].subtreeCount == 0) continue;
+            float x0, y0, x1, y1;
+            area(child + i, x0, y0, x1, y1);
+            if (!RayoCaja(ox, oy, invX, invY, x0, y0, x1, y1, tMax, t)) continue;
+            int j = m++;
+            while (j > 0 && entrada[j - 1] > t) { entrada[j] = entrada[j - 1]; orden[j] = orden[j - 1]; j--; }
+            entrada[j] = t; orden[j] = child + i;
+        }
+        for (int i = 0; i < m; i++) {
+            if (hay && entrada[i] > hit.t) break;
+            raycastNode(orden[i], ox, oy, invX, invY, tMax, tipo, hit, hay);
+        }
+    }
+
+    //Cada par sale una sola vez: los objetos de un nodo se prueban entre ellos y contra los de sus
+    //descendientes, nunca contra los de sus ancestros (eso ya lo hizo el ancestro). Asi cada nodo es
+    //una tarea independiente y se pueden recorrer en el orden del arreglo, sin recursion desde la raiz.
+    size_t tareasPares() const override { return nodes.size(); }
+
+    void paresTarea(size_t desde, size_t hasta, MiVector<ColPair>& pares) const override {
+        for (size_t n = desde; n < hasta; n++) {
+            if (nodes[n].level == -1) continue; //bloque libre
+            if (lleno(pares)) return;
+            int child = nodes[n].firstChild;
+            for (int it = nodes[n].firstItem; it != -1; it = nextItem[it]) {
+                for (int it2 = nextItem[it]; it2 != -1; it2 = nextItem[it2]) emitir(pares, items[it], items[it2]);
+                if (child != -1) {
+                    for (int i = 0; i < 4; i++) pairsSubtree(pares, it, child + i);
+                }
+            }
+        }
+    }
+
+    void pairsSubtree(MiVector<ColPair>& pares, int it, int n) const { //item 'it' contra todo el subarbol n
+        if (nodes[n].subtreeCount == 0 || !toca(n, items[it].bounds) || lleno(pares)) return; //poda: nada ahi puede tocarlo
+        for (int it2 = nodes[n].firstItem; it2 != -1; it2 = nextItem[it2]) emitir(pares, items[it], items[it2]);
+        if (nodes[n].firstChild != -1) {
+            for (int i = 0; i < 4; i++) pairsSubtree(pares, it, nodes[n].firstChild + i);
+        }
+    }
+
+    //para dibujar las lineas del Quadtree; como los nodos estan en un arreglo plano basta recorrerlo
+    void getAllBounds(MiVector<Rect>& list) const override {
+        for (size_t i = 0; i < nodes.size(); i++) if (nodes[i].level != -1) list.push_back(boundsNodo((int)i));
+    }
+};
+
+//configuracion del juego: segun 'bench --autotune', 16 por hoja y 6 niveles esta cerca de la mejor
+//desde una partida normal hasta ~1000 entidades (4/5 tarda el doble); escenas de 10k prefieren 8/7
+typedef QuadtreeT<16, 6> Quadtree;
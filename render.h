@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+
+#include "mivector.h"
+#include "geometria.h"
+#include "world.h"
+
+// ------------------------------------------
+// PARTE 8: RENDER POR LOTES
+// ------------------------------------------
+//En vez de un DrawLine por arista (8-12 por asteroide), un DrawRectangleLines por nodo o hitbox y un
+//DrawRectangle por bala, el frame se arma en dos arreglos de vertices (segmentos y quads) que se mandan
+//de una vez. Cada arreglo se dimensiona al principio con la cuenta exacta de lo que se va a dibujar y
+//despues se escribe por puntero. El armado no conoce raylib: el destino es una SalidaRender (rlgl en el
+//juego, un contador en headless), asi el conteo de draw calls y vertices se puede probar sin ventana.
+
+struct ColorRGBA { unsigned char r, g, b, a; }; //mismo layout que Color de raylib
+
+//los colores de siempre (valores de raylib); las transparencias son las de Fade()
+const ColorRGBA COLOR_NAVE = { 0, 228, 48, 255 }; //GREEN
+const ColorRGBA COLOR_MIRA = { 200, 122, 255, 127 }; //Fade(PURPLE, 0.5f)
+const ColorRGBA COLOR_ASTEROIDE = { 255, 255, 255, 255 }; //WHITE
+const ColorRGBA COLOR_BALA = { 253, 249, 0, 255 }; //YELLOW
+const ColorRGBA COLOR_NODO = { 130, 130, 130, 76 }; //Fade(GRAY, 0.3f)
+const ColorRGBA COLOR_HITBOX = { 230, 41, 55, 255 }; //RED
+
+struct Vertice {
+    float x, y;
+    ColorRGBA c;
+};
+
+//Destino de un lote. lineas(): cada dos vertices un segmento. quads(): cada cuatro un rectangulo
+//relleno (arriba-izq, abajo-izq, abajo-der, arriba-der, el orden de rlgl).
+class SalidaRender {
+public:
+    virtual ~SalidaRender() = default;
+    virtual void lineas(const Vertice* v, size_t n) = 0;
+    virtual void quads(const Vertice* v, size_t n) = 0;
+};
+
+struct ContadoresRender {
+    int drawCalls = 0; //lotes mandados (uno por arreglo no vacio)
+    int vertices = 0;
+};
+
+//Para headless: no dibuja nada, solo cuenta lo que le llega.
+class SalidaConteo : public SalidaRender {
+public:
+    ContadoresRender total;
+    void lineas(const Vertice*, size_t n) override { total.drawCalls++; total.vertices += (int)n; }
+    void quads(const Vertice*, size_t n) override { total.drawCalls++; total.vertices += (int)n; }
+};
+
+class LoteRender {
+private:
+    MiVector<Vertice> segs, rects;
+    size_t usadosSegs = 0, usadosRects = 0;
+
+    static void poner(Vertice* v, float x, float y, ColorRGBA c) { v->x = x; v->y = y; v->c = c; }
+
+public:
+    ContadoresRender ultimo; //lo que se mando en el ultimo enviar()
+
+    //Deja lugar para exactamente tantos segmentos y rectangulos. Crece con 50% de margen y la capacidad
+    //se conserva entre frames, asi que una partida normal no pide memoria despues de los primeros frames.
+    void empezar(size_t segmentos, size_t rectangulos) {
+        if (segs.capacity() < segmentos * 2) segs.reserve(segmentos * 3);
+        if (rects.capacity() < rectangulos * 4) rects.reserve(rectangulos * 6);
+        segs.resize(segmentos * 2); rects.resize(rectangulos * 4);
+        usadosSegs = usadosRects = 0;
+    }
+
+    void reservar(size_t segmentos, size_t rectangulos) { segs.reserve(segmentos * 2); rects.reserve(rectangulos * 4); }
+
+    Vertice* pedirSegmentos(size_t n) { Vertice* v = &segs[usadosSegs]; usadosSegs += n * 2; return v; }
+
+    void linea(float x0, float y0, float x1, float y1, ColorRGBA c) {
+        Vertice* v = pedirSegmentos(1);
+        poner(v, x0, y0, c); poner(v + 1, x1, y1, c);
+    }
+
+    void contorno(const Rect& r, ColorRGBA c) { //4 segmentos
+        float x1 = r.x + r.width, y1 = r.y + r.height;
+        Vertice* v = pedirSegmentos(4);
+        poner(v + 0, r.x, r.y, c); poner(v + 1, x1, r.y, c);
+        poner(v + 2, x1, r.y, c); poner(v + 3, x1, y1, c);
+        poner(v + 4, x1, y1, c); poner(v + 5, r.x, y1, c);
+        poner(v + 6, r.x, y1, c); poner(v + 7, r.x, r.y, c);
+    }
+
+    void relleno(float x, float y, float w, float h, ColorRGBA c) {
+        Vertice* v = &rects[usadosRects];
+        usadosRects += 4;
+        poner(v + 0, x, y, c); poner(v + 1, x, y + h, c); poner(v + 2, x + w, y + h, c); poner(v + 3, x + w, y, c);
+    }
+
+    size_t segmentos() const { return usadosSegs / 2; }
+
+    void enviar(SalidaRender& salida) {
+        ultimo = ContadoresRender();
+        if (usadosSegs) { salida.lineas(segs.data(), usadosSegs); ultimo.drawCalls++; ultimo.vertices += (int)usadosSegs; }
+        if (usadosRects) { salida.quads(rects.data(), usadosRects); ultimo.drawCalls++; ultimo.vertices += (int)usadosRects; }
+        usadosSegs = usadosRects = 0;
+    }
+};
+
+//Nave: la punta y las dos esquinas traseras (+-140 grados) salen del cos/sin de la rotacion (c, s)
+//rotando por constantes, en vez de 6 cos/sin por nave y por frame.
+inline void LoteNave(LoteRender& lote, float cx, float cy, float c, float s) {
+    static const float C140 = cosf(140 * DEG2RAD), S140 = sinf(140 * DEG2RAD);
+    float ax = cx + c * 15, ay = cy + s * 15;
+    float bx = cx + (c * C140 - s * S140) * 10, by = cy + (s * C140 + c * S140) * 10;
+    float dx = cx + (c * C140 + s * S140) * 10, dy = cy + (s * C140 - c * S140) * 10;
+    lote.linea(ax, ay, bx, by, COLOR_NAVE);
+    lote.linea(bx, by, dx, dy, COLOR_NAVE);
+    lote.linea(dx, dy, ax, ay, COLOR_NAVE);
+}
+
+//Contornos de todos los asteroides: los puntos ya estan en pantalla (World::contornos, uno por vertice
+//del poligono), asi que cada arista es un par de puntos seguidos, escrito directo en el arreglo del lote.
+//Con interpolacion se corre todo el asteroide lo mismo (-vel * atras).
+inline void LoteAsteroides(LoteRender& lote, const Asteroides& ast, const ContornosAsteroides& con, float atras = 0.0f) {
+    assert(con.inicio.size() == ast.count() + 1 && "contornos viejos: falta World::prepararContornos()");
+    for (size_t i = 0; i < ast.count(); i++) {
+        float dx = -ast.vx[i] * atras, dy = -ast.vy[i] * atras;
+        uint32_t k0 = con.inicio[i], n = con.inicio[i + 1] - k0;
+        const float* cx = con.x.data() + k0;
+        const float* cy = con.y.data() + k0;
+        Vertice* v = lote.pedirSegmentos(n);
+        float px = cx[n - 1] + dx, py = cy[n - 1] + dy; //la ultima arista cierra el poligono
+        for (uint32_t k = 0; k < n; k++) {
+            float qx = cx[k] + dx, qy = cy[k] + dy;
+            v[2 * k] = { px, py, COLOR_ASTEROIDE };
+            v[2 * k + 1] = { qx, qy, COLOR_ASTEROIDE };
+            px = qx; py = qy;
+        }
+    }
+}
+
+//Lo mas que puede pedir ArmarLote con los jugadores de ahora, los pools de world llenos y hasta maxNodos
+//celdas/nodos de overlay (con hitboxes): reservado antes de jugar, el lote no pide memoria en la partida.
+inline void ReservarLote(LoteRender& lote, const World& world, size_t maxNodos) {
+    size_t J = world.jugadores.count(), A = world.asteroides.capacity();
+    size_t segmentos = J * 4 + A * MAX_PUNTOS_FORMA + maxNodos * 4 + (J + A) * 4; //naves y miras, contornos, overlay, hitboxes
+    lote.reservar(segmentos, world.balas.capacity());
+}
+
+//Todo lo que el juego dibuja con lineas y rectangulos en un frame. nodos = celdas/nodos de la
+//broadphase para el overlay de debug (nullptr = apagado).
+//Los asteroides salen de world.contornos, que se rearman aqui si cambio algo (ver World::prepararContornos).
+//atras = cuanto tiempo antes del ultimo paso se dibuja, para interpolar cuando el render va mas rapido
+//que la simulacion (ver el acumulador de main.cpp). Cada entidad se dibuja en pos - vel * atras: para
+//asteroides y balas (velocidad constante) es justo la interpolacion entre los dos ultimos pasos, sin
+//guardar las posiciones anteriores; la nave frena por friccion y queda apenas corrida. En el paso en que algo
+//da la vuelta a la pantalla se dibuja fuera del borde, igual que antes de aparecer. Las hitboxes son las
+//de la simulacion y no se interpolan.
+inline void ArmarLote(LoteRender& lote, World& world, const MiVector<Rect>* nodos, bool hitboxes, float atras = 0.0f) {
+    world.prepararContornos(); //el tamanio del lote sale de los contornos: tienen que estar al dia
+    const Jugadores& J = world.jugadores;
+    const Asteroides& A = world.asteroides;
+    size_t segmentos = J.count() * 3, bots = 0;
+    for (size_t j = 0; j < J.count(); j++) bots += J.esBot[j] ? 1 : 0;
+    segmentos += bots;
+    segmentos += world.contornos.puntos(); //un segmento por vertice de cada poligono
+    if (nodos) segmentos += nodos->size() * 4;
+    if (hitboxes) segmentos += (J.count() + A.count()) * 4;
+    lote.empezar(segmentos, world.balas.count());
+
+    for (size_t j = 0; j < J.count(); j++) {
+        float cx = J.x[j] - J.vx[j] * atras + PLAYER_SIZE / 2, cy = J.y[j] - J.vy[j] * atras + PLAYER_SIZE / 2;
+        float c = cosf(J.rotation[j] * DEG2RAD), s = sinf(J.rotation[j] * DEG2RAD);
+        LoteNave(lote, cx, cy, c, s);
+        if (J.esBot[j]) lote.linea(cx, cy, cx + c * 800, cy + s * 800, COLOR_MIRA); //linea de mira del bot
+    }
+    LoteAsteroides(lote, A, world.contornos, atras);
+    const Balas& B = world.balas;
+    for (size_t i = 0; i < B.count(); i++) { //enteros como el DrawRectangle de antes
+        lote.relleno((float)(int)(B.x[i] - B.vx[i] * atras), (float)(int)(B.y[i] - B.vy[i] * atras), BULLET_SIZE, BULLET_SIZE, COLOR_BALA);
+    }
+    if (nodos) {
+        for (size_t i = 0; i < nodos->size(); i++) lote.contorno((*nodos)[i], COLOR_NODO);
+    }
+    if (hitboxes) { //solo jugadores y asteroides
+        for (size_t j = 0; j < J.count(); j++) lote.contorno(J.bounds(j), COLOR_HITBOX);
+        for (size_t i = 0; i < A.count(); i++) lote.contorno(A.bounds(i), COLOR_HITBOX);
+    }
+}
+
+//Cuantas llamadas de dibujo hacia el render inmediato de antes para el mismo frame (para comparar).
+inline int LlamadasInmediatas(const World& world, const MiVector<Rect>* nodos, bool hitboxes) {
+    const Jugadores& J = world.jugadores;
+    const Asteroides& A = world.asteroides;
+    int n = (int)J.count() + (int)world.balas.count();
+    for (size_t j = 0; j < J.count(); j++) n += J.esBot[j] ? 1 : 0;
+    n += (int)world.contornos.puntos();
+    if (nodos) n += (int)nodos->size();
+    if (hitboxes) n += (int)(J.count() + A.count());
+    return n;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include "mivector.h"
+#include "world.h"
+
+// ------------------------------------------
+// PARTE 6: GRABACION Y REPLAY
+// ------------------------------------------
+//Una partida queda determinada por la semilla, el modo (bot o no), y por tick: el dt y las teclas. La
+//broadphase en uso ya no cambia el resultado (los pares se resuelven por indice de entidad) pero se
+//guarda igual, para que el replay mida las mismas estructuras. InputLog guarda solo eso, 5 bytes por
+//tick, y cada tanto el hash del estado para detectar el primer tick en el que un replay se separa del original.
+//
+//Archivo (little endian, como x86 y wasm): CabeceraLog, teclas[ticks], dt[ticks], checkpoints[].
+
+const uint32_t LOG_MAGIA = 0x52545341; //"ASTR"
+const uint32_t LOG_VERSION = 7; //2: el quadtree ubica distinto lo que asoma por los bordes (otro orden de pares); 3: balas con prueba barrida
+//4: las formas salen de una biblioteca (otra secuencia del rng); 5: los choques se resuelven por indice de entidad
+//6: el barrido de una bala que sale por un borde empieza donde estaba y no del otro lado; 7: el bot elige el
+//asteroide por distancia de centro a centro (antes de esquina a esquina) y vuelve a disparar solo dentro del
+//cono (tiroEnLinea apagado)
+
+//bits 0-4 teclas, bits 5-6 broadphase
+inline uint8_t EmpaquetarTick(const InputState& in, TipoBroadphase bp) {
+    return (uint8_t)((in.left ? 1 : 0) | (in.right ? 2 : 0) | (in.thrust ? 4 : 0) | (in.brake ? 8 : 0) |
+                     (in.shoot ? 16 : 0) | ((int)bp << 5));
+}
+inline InputState DesempaquetarTeclas(uint8_t b) {
+    InputState in;
+    in.left = b & 1; in.right = b & 2; in.thrust = b & 4; in.brake = b & 8; in.shoot = b & 16;
+    return in;
+}
+inline TipoBroadphase DesempaquetarBroadphase(uint8_t b) { return (TipoBroadphase)((b >> 5) & 3); }
+
+struct Checkpoint {
+    uint32_t tick; //cantidad de steps hechos cuando se tomo el hash
+    uint32_t relleno;
+    uint64_t hash;
+};
+
+struct CabeceraLog {
+    uint32_t magia, version;
+    uint32_t semilla;
+    uint32_t bot;
+    uint32_t ticks, checkpoints;
+    uint32_t cadaCheckpoint;
+    uint32_t bots; //0 en las grabaciones anteriores al enjambre = 1
+};
+
+class InputLog {
+public:
+    uint32_t semilla = 0;
+    bool bot = false;
+    uint32_t bots = 1;
+    uint32_t cadaCheckpoint = 60; //un hash por segundo de juego a 60 Hz
+    MiVector<uint8_t> teclas;
+    MiVector<float> dts;
+    MiVector<Checkpoint> checkpoints;
+
+    size_t ticks() const { return teclas.size(); }
+
+    void reservar(size_t ticks) { teclas.reserve(ticks); dts.reserve(ticks); checkpoints.reserve(cadaCheckpoint ? ticks / cadaCheckpoint + 1 : 0); }
+
+    //antes de world.reset(): siembra el mundo y deja el log vacio
+    void empezar(World& world, uint32_t _semilla, bool _bot, uint32_t _bots = 1) {
+        semilla = _semilla; bot = _bot; bots = _bots;
+        teclas.clear(); dts.clear(); checkpoints.clear();
+        world.sembrar(semilla);
+    }
+
+    //despues de cada world.step(): anota lo que se uso y, si toca, el hash del estado resultante
+    void anotar(const World& world, float dt, const InputState& in) {
+        teclas.push_back(EmpaquetarTick(in, world.tipoBroadphase));
+        dts.push_back(dt);
+        uint32_t n = (uint32_t)teclas.size();
+        if (cadaCheckpoint && n % cadaCheckpoint == 0) checkpoints.push_back({ n, 0, world.hashEstado() });
+    }
+
+    //antes de guardar, con el mundo en el ultimo tick anotado: agrega el hash del estado final (si no
+    //cayo justo en un checkpoint), asi el replay tambien comprueba como termino la partida
+    void cerrar(const World& world) {
+        uint32_t n = (uint32_t)teclas.size();
+        if (n && (checkpoints.empty() || checkpoints.back().tick != n)) checkpoints.push_back({ n, 0, world.hashEstado() });
+    }
+
+    //vuelve al tick dado (despues de rebobinar): lo que se juegue desde ahi reemplaza a lo grabado
+    void truncar(size_t ticks) {
+        if (ticks >= teclas.size()) return;
+        teclas.resize(ticks); dts.resize(ticks);
+        while (!checkpoints.empty() && checkpoints.back().tick > ticks) checkpoints.pop_back();
+    }
+
+    bool guardar(const char* ruta) const {
+        FILE* f = fopen(ruta, "wb");
+        if (!f) return false;
+        CabeceraLog c = { LOG_MAGIA, LOG_VERSION, semilla, bot ? 1u : 0u, (uint32_t)teclas.size(),
+                          (uint32_t)checkpoints.size(), cadaCheckpoint, bots };
+        bool ok = fwrite(&c, sizeof(c), 1, f) == 1;
+        if (ok && c.ticks) ok = fwrite(teclas.data(), 1, c.ticks, f) == c.ticks &&
+                                fwrite(dts.data(), sizeof(float), c.ticks, f) == c.ticks;
+        if (ok && c.checkpoints) ok = fwrite(checkpoints.data(), sizeof(Checkpoint), c.checkpoints, f) == c.checkpoints;
+        return fclose(f) == 0 && ok;
+    }
+
+    bool cargar(const char* ruta) {
+        FILE* f = fopen(ruta, "rb");
+        if (!f) return false;
+        CabeceraLog c;
+        bool ok = fread(&c, sizeof(c), 1, f) == 1 && c.magia == LOG_MAGIA && c.version == LOG_VERSION;
+        if (ok) {
+            semilla = c.semilla; bot = c.bot != 0; cadaCheckpoint = c.cadaCheckpoint; bots = c.bots ? c.bots : 1;
+            teclas.resize(c.ticks); dts.resize(c.ticks); checkpoints.resize(c.checkpoints);
+            if (c.ticks) ok = fread(teclas.data(), 1, c.ticks, f) == c.ticks &&
+                              fread(dts.data(), sizeof(float), c.ticks, f) == c.ticks;
+            if (ok && c.checkpoints) ok = fread(checkpoints.data(), sizeof(Checkpoint), c.checkpoints, f) == c.checkpoints;
+        }
+        fclose(f);
+        return ok;
+    }
+};
+
+struct ResultadoReplay {
+    uint32_t ticks = 0; //steps simulados
+    uint32_t verificados = 0; //checkpoints que coincidieron
+    int64_t tickDivergencia = -1; //primer checkpoint distinto; -1 = ninguno
+    uint64_t esperado = 0, obtenido = 0;
+    uint32_t tickMasLento = 0; //solo con profiler: para ir directo al pico
+    double usMasLento = 0;
+};
+
+//Vuelve a simular la partida sin dibujar ni esperar al reloj. Se corta en el primer checkpoint distinto.
+//Si la grabacion se cerro con cerrar(), el ultimo checkpoint es el del tick final.
+//Con profiler cada step queda como un frame (y se anota el tick mas lento).
+inline ResultadoReplay Reproducir(World& world, const InputLog& log, Profiler* profiler = nullptr) {
+    typedef std::chrono::steady_clock Reloj;
+    ResultadoReplay r;
+    world.sembrar(log.semilla);
+    world.reset(log.bot, (int)log.bots);
+    size_t proximo = 0;
+    for (size_t t = 0; t < log.ticks(); t++) {
+        TipoBroadphase bp = DesempaquetarBroadphase(log.teclas[t]);
+        if (bp != world.tipoBroadphase) world.setBroadphase(bp);
+        if (profiler) {
+            profiler->beginFrame();
+            Reloj::time_point t0 = Reloj::now();
+            world.step(log.dts[t], DesempaquetarTeclas(log.teclas[t]));
+            double us = std::chrono::duration<double, std::micro>(Reloj::now() - t0).count();
+            profiler->endFrame();
+            if (us > r.usMasLento) { r.usMasLento = us; r.tickMasLento = (uint32_t)t + 1; }
+        } else {
+            world.step(log.dts[t], DesempaquetarTeclas(log.teclas[t]));
+        }
+        r.ticks++;
+        if (proximo < log.checkpoints.size() && log.checkpoints[proximo].tick == r.ticks) {
+            uint64_t h = world.hashEstado();
+            if (h != log.checkpoints[proximo].hash) {
+                r.tickDivergencia = r.ticks; r.esperado = log.checkpoints[proximo].hash; r.obtenido = h;
+                break;
+            }
+            r.verificados++;
+            proximo++;
+        }
+    }
+    return r;
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+#include "geometria.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_SSE2 1
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define SIMD_WASM 1
+#endif
+
+// ------------------------------------------
+// PARTE 3.4: KERNELS SIMD
+// ------------------------------------------
+//Los arreglos SoA de World se pueden procesar de a 4 u 8 floats. El camino se elige al compilar:
+//AVX (con -mavx), SSE2 (cualquier x86-64), SIMD128 de wasm (emcc -msimd128) o escalar.
+//Los kernels no tienen ramas por elemento: la envoltura de pantalla se hace con comparacion +
+//seleccion, y dan exactamente lo mismo que la version escalar (mismas operaciones en el mismo orden).
+
+inline const char* SimdNombre() {
+#if defined(SIMD_AVX)
+    return "avx";
+#elif defined(SIMD_SSE2)
+    return "sse2";
+#elif defined(SIMD_WASM)
+    return "wasm-simd128";
+#else
+    return "escalar";
+#endif
+}
+
+const int LOTE_AABB = 8; //cajas por llamada a CajaContraLote
+
+//pos += vel * dt y envoltura: si pasa de 'limite' vuelve a -margen, si queda antes de -margen va a 'limite'.
+//margen = nullptr usa margenFijo para todos (balas: 0; asteroides: su ancho, para que salgan enteros).
+inline void IntegrarEnvolverEscalar(float* pos, const float* vel, const float* margen, float margenFijo,
+                                    float limite, size_t n, float dt) {
+    for (size_t i = 0; i < n; i++) {
+        float lo = 0.0f - (margen ? margen[i] : margenFijo); //0 - 0 = +0, igual que los kernels
+        float p = pos[i] + vel[i] * dt;
+        if (p > limite) p = lo;
+        if (p < lo) p = limite;
+        pos[i] = p;
+    }
+}
+
+inline void IntegrarEnvolver(float* pos, const float* vel, const float* margen, float margenFijo,
+                             float limite, size_t n, float dt) {
+    size_t i = 0;
+#if defined(SIMD_AVX)
+    __m256 vdt = _mm256_set1_ps(dt), vlim = _mm256_set1_ps(limite), vfijo = _mm256_set1_ps(0.0f - margenFijo);
+    for (; i + 8 <= n; i += 8) {
+        __m256 lo = margen ? _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(margen + i)) : vfijo;
+        __m256 p = _mm256_add_ps(_mm256_loadu_ps(pos + i), _mm256_mul_ps(_mm256_loadu_ps(vel + i), vdt));
+        p = _mm256_blendv_ps(p, lo, _mm256_cmp_ps(p, vlim, _CMP_GT_OQ));
+        p = _mm256_blendv_ps(p, vlim, _mm256_cmp_ps(p, lo, _CMP_LT_OQ));
+        _mm256_storeu_ps(pos + i, p);
+    }
+#elif defined(SIMD_SSE2)
+    __m128 vdt = _mm_set1_ps(dt), vlim = _mm_set1_ps(limite), vfijo = _mm_set1_ps(0.0f - margenFijo);
+    for (; i + 4 <= n; i += 4) {
+        __m128 lo = margen ? _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(margen + i)) : vfijo;
+        __m128 p = _mm_add_ps(_mm_loadu_ps(pos + i), _mm_mul_ps(_mm_loadu_ps(vel + i), vdt));
+        __m128 m = _mm_cmpgt_ps(p, vlim);
+        p = _mm_or_ps(_mm_and_ps(m, lo), _mm_andnot_ps(m, p));
+        m = _mm_cmplt_ps(p, lo);
+        p = _mm_or_ps(_mm_and_ps(m, vlim), _mm_andnot_ps(m, p));
+        _mm_storeu_ps(pos + i, p);
+    }
+#elif defined(SIMD_WASM)
+    v128_t vdt = wasm_f32x4_splat(dt), vlim = wasm_f32x4_splat(limite), vfijo = wasm_f32x4_splat(0.0f - margenFijo);
+    for (; i + 4 <= n; i += 4) {
+        v128_t lo = margen ? wasm_f32x4_sub(wasm_f32x4_splat(0.0f), wasm_v128_load(margen + i)) : vfijo;
+        v128_t p = wasm_f32x4_add(wasm_v128_load(pos + i), wasm_f32x4_mul(wasm_v128_load(vel + i), vdt));
+        p = wasm_v128_bitselect(lo, p, wasm_f32x4_gt(p, vlim));
+        p = wasm_v128_bitselect(vlim, p, wasm_f32x4_lt(p, lo));
+        wasm_v128_store(pos + i, p);
+    }
+#endif
+    IntegrarEnvolverEscalar(pos + i, vel + i, margen ? margen + i : nullptr, margenFijo, limite, n - i, dt); //la cola
+}
+
+//Una caja contra n <= LOTE_AABB cajas (x, y, ancho, alto en arreglos); bit j = choca con la j-esima.
+//Mismo criterio que Rect::intersects.
+inline unsigned CajaContraLoteEscalar(const Rect& a, const float* x, const float* y, const float* w, const float* h, int n) {
+    unsigned mask = 0;
+    for (int j = 0; j < n; j++) {
+        if (a.x < x[j] + w[j] && a.x + a.width > x[j] && a.y < y[j] + h[j] && a.y + a.height > y[j]) mask |= 1u << j;
+    }
+    return mask;
+}
+
+//Los arreglos deben tener LOTE_AABB lugares aunque n sea menor (los que sobran se ignoran).
+inline unsigned CajaContraLote(const Rect& a, const float* x, const float* y, const float* w, const float* h, int n) {
+#if defined(SIMD_AVX)
+    __m256 bx = _mm256_loadu_ps(x), by = _mm256_loadu_ps(y);
+    __m256 c = _mm256_and_ps(_mm256_cmp_ps(_mm256_set1_ps(a.x), _mm256_add_ps(bx, _mm256_loadu_ps(w)), _CMP_LT_OQ),
+                             _mm256_cmp_ps(_mm256_set1_ps(a.x + a.width), bx, _CMP_GT_OQ));
+    c = _mm256_and_ps(c, _mm256_cmp_ps(_mm256_set1_ps(a.y), _mm256_add_ps(by, _mm256_loadu_ps(h)), _CMP_LT_OQ));
+    c = _mm256_and_ps(c, _mm256_cmp_ps(_mm256_set1_ps(a.y + a.height), by, _CMP_GT_OQ));
+    return (unsigned)_mm256_movemask_ps(c) & ((1u << n) - 1);
+#elif defined(SIMD_SSE2)
+    __m128 ax0 = _mm_set1_ps(a.x), ax1 = _mm_set1_ps(a.x + a.width);
+    __m128 ay0 = _mm_set1_ps(a.y), ay1 = _mm_set1_ps(a.y + a.height);
+    unsigned mask = 0;
+    for (int k = 0; k < LOTE_AABB; k += 4) {
+        __m128 bx = _mm_loadu_ps(x + k), by = _mm_loadu_ps(y + k);
+        __m128 c = _mm_and_ps(_mm_cmplt_ps(ax0, _mm_add_ps(bx, _mm_loadu_ps(w + k))), _mm_cmpgt_ps(ax1, bx));
+        c = _mm_and_ps(c, _mm_and_ps(_mm_cmplt_ps(ay0, _mm_add_ps(by, _mm_loadu_ps(h + k))), _mm_cmpgt_ps(ay1, by)));
+        mask |= (unsigned)_mm_movemask_ps(c) << k;
+    }
+    return mask & ((1u << n) - 1);
+#elif defined(SIMD_WASM)
+    v128_t ax0 = wasm_f32x4_splat(a.x), ax1 = wasm_f32x4_splat(a.x + a.width);
+    v128_t ay0 = wasm_f32x4_splat(a.y), ay1 = wasm_f32x4_splat(a.y + a.height);
+    unsigned mask = 0;
+    for (int k = 0; k < LOTE_AABB; k += 4) {
+        v128_t bx = wasm_v128_load(x + k), by = wasm_v128_load(y + k);
+        v128_t c = wasm_v128_and(wasm_f32x4_lt(ax0, wasm_f32x4_add(bx, wasm_v128_load(w + k))), wasm_f32x4_gt(ax1, bx));
+        c = wasm_v128_and(c, wasm_v128_and(wasm_f32x4_lt(ay0, wasm_f32x4_add(by, wasm_v128_load(h + k))), wasm_f32x4_gt(ay1, by)));
+        mask |= (unsigned)wasm_i32x4_bitmask(c) << k;
+    }
+    return mask & ((1u << n) - 1);
+#else
+    return CajaContraLoteEscalar(a, x, y, w, h, n);
+#endif
+}
+
+//Version barrida de CajaContraLote para objetos rapidos (balas: 1100 px/s son 37 px por paso a 30 Hz,
+//mas que un asteroide chico). Las posiciones son las del final del paso; a se movio (amx, amy) y la
+//j-esima caja (mx[j], my[j]) durante el paso. Con movimiento relativo, en cada eje la separacion
+//d(t) = d0 + t * dd es lineal, asi que el tramo de t en [0, 1] con solape es un intervalo; hay choque
+//si los intervalos de x e y se cruzan adentro del paso. Sin movimiento relativo (dd == 0) el eje
+//solapa siempre o nunca; con todo quieto da lo mismo que CajaContraLote.
+const float BARRIDO_LEJOS = 1e30f;
+
+inline void IntervaloBarrido(float a0, float aw, float am, float b0, float bw, float bm, float& lo, float& hi) {
+    float dd = bm - am, d0 = (b0 - a0) - dd; //separacion al principio del paso
+    if (dd == 0) {
+        bool dentro = d0 > 0.0f - bw && d0 < aw;
+        lo = dentro ? -BARRIDO_LEJOS : BARRIDO_LEJOS;
+        hi = dentro ? BARRIDO_LEJOS : -BARRIDO_LEJOS;
+        return;
+    }
+    float t0 = ((0.0f - bw) - d0) / dd, t1 = (aw - d0) / dd;
+    lo = std::min(t0, t1);
+    hi = std::max(t0, t1);
+}
+
+inline unsigned BarridoContraLoteEscalar(const Rect& a, float amx, float amy, const float* x, const float* y,
+                                         const float* w, const float* h, const float* mx, const float* my, int n) {
+    unsigned mask = 0;
+    for (int j = 0; j < n; j++) {
+        float lox, hix, loy, hiy;
+        IntervaloBarrido(a.x, a.width, amx, x[j], w[j], mx[j], lox, hix);
+        IntervaloBarrido(a.y, a.height, amy, y[j], h[j], my[j], loy, hiy);
+        float lo = std::max(lox, loy), hi = std::min(hix, hiy);
+        if (lo < hi && lo < 1.0f && hi > 0.0f) mask |= 1u << j;
+    }
+    return mask;
+}
+
+//Mismas operaciones de a 4/8: la division de los ejes sin movimiento relativo da inf o NaN y se
+//reemplaza con una seleccion, asi que el resultado es el de la version escalar bit a bit.
+inline unsigned BarridoContraLote(const Rect& a, float amx, float amy, const float* x, const float* y,
+                                  const float* w, const float* h, const float* mx, const float* my, int n) {
+#if defined(SIMD_AVX)
+    const __m256 cero = _mm256_setzero_ps(), lejos = _mm256_set1_ps(BARRIDO_LEJOS), menosLejos = _mm256_set1_ps(-BARRIDO_LEJOS);
+    auto eje = [&](float a0, float aw, float am, __m256 b0, __m256 bw, __m256 bm, __m256& lo, __m256& hi) {
+        __m256 va = _mm256_set1_ps(aw);
+        __m256 dd = _mm256_sub_ps(bm, _mm256_set1_ps(am));
+        __m256 d0 = _mm256_sub_ps(_mm256_sub_ps(b0, _mm256_set1_ps(a0)), dd);
+        __m256 menosB = _mm256_sub_ps(cero, bw);
+        __m256 t0 = _mm256_div_ps(_mm256_sub_ps(menosB, d0), dd), t1 = _mm256_div_ps(_mm256_sub_ps(va, d0), dd);
+        __m256 quieto = _mm256_cmp_ps(dd, cero, _CMP_EQ_OQ);
+        __m256 dentro = _mm256_and_ps(_mm256_cmp_ps(d0, menosB, _CMP_GT_OQ), _mm256_cmp_ps(d0, va, _CMP_LT_OQ));
+        lo = _mm256_blendv_ps(_mm256_min_ps(t0, t1), _mm256_blendv_ps(lejos, menosLejos, dentro), quieto);
+        hi = _mm256_blendv_ps(_mm256_max_ps(t0, t1), _mm256_blendv_ps(menosLejos, lejos, dentro), quieto);
+    };
+    __m256 lox, hix, loy, hiy;
+    eje(a.x, a.width, amx, _mm256_loadu_ps(x), _mm256_loadu_ps(w), _mm256_loadu_ps(mx), lox, hix);
+    eje(a.y, a.height, amy, _mm256_loadu_ps(y), _mm256_loadu_ps(h), _mm256_loadu_ps(my), loy, hiy);
+    __m256 lo = _mm256_max_ps(lox, loy), hi = _mm256_min_ps(hix, hiy);
+    __m256 c = _mm256_and_ps(_mm256_cmp_ps(lo, hi, _CMP_LT_OQ), _mm256_cmp_ps(lo, _mm256_set1_ps(1.0f), _CMP_LT_OQ));
+    c = _mm256_and_ps(c, _mm256_cmp_ps(hi, cero, _CMP_GT_OQ));
+    return (unsigned)_mm256_movemask_ps(c) & ((1u << n) - 1);
+#elif defined(SIMD_SSE2)
+    const __m128 cero = _mm_setzero_ps(), lejos = _mm_set1_ps(BARRIDO_LEJOS), menosLejos = _mm_set1_ps(-BARRIDO_LEJOS);
+    auto elegir = [](__m128 m, __m128 si, __m128 no) { return _mm_or_ps(_mm_and_ps(m, si), _mm_andnot_ps(m, no)); };
+    auto eje = [&](float a0, float aw, float am, __m128 b0, __m128 bw, __m128 bm, __m128& lo, __m128& hi) {
+        __m128 va = _mm_set1_ps(aw);
+        __m128 dd = _mm_sub_ps(bm, _mm_set1_ps(am));
+        __m128 d0 = _mm_sub_ps(_mm_sub_ps(b0, _mm_set1_ps(a0)), dd);
+        __m128 menosB = _mm_sub_ps(cero, bw);
+        __m128 t0 = _mm_div_ps(_mm_sub_ps(menosB, d0), dd), t1 = _mm_div_ps(_mm_sub_ps(va, d0), dd);
+        __m128 quieto = _mm_cmpeq_ps(dd, cero);
+        __m128 dentro = _mm_and_ps(_mm_cmpgt_ps(d0, menosB), _mm_cmplt_ps(d0, va));
+        lo = elegir(quieto, elegir(dentro, menosLejos, lejos), _mm_min_ps(t0, t1));
+        hi = elegir(quieto, elegir(dentro, lejos, menosLejos), _mm_max_ps(t0, t1));
+    };
+    unsigned mask = 0;
+    for (int k = 0; k < LOTE_AABB; k += 4) {
+        __m128 lox, hix, loy, hiy;
+        eje(a.x, a.width, amx, _mm_loadu_ps(x + k), _mm_loadu_ps(w + k), _mm_loadu_ps(mx + k), lox, hix);
+        eje(a.y, a.height, amy, _mm_loadu_ps(y + k), _mm_loadu_ps(h + k), _mm_loadu_ps(my + k), loy, hiy);
+        __m128 lo = _mm_max_ps(lox, loy), hi = _mm_min_ps(hix, hiy);
+        __m128 c = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(lo, hi), _mm_cmplt_ps(lo, _mm_set1_ps(1.0f))), _mm_cmpgt_ps(hi, cero));
+        mask |= (unsigned)_mm_movemask_ps(c) << k;
+    }
+    return mask & ((1u << n) - 1);
+#elif defined(SIMD_WASM)
+    const v128_t cero = wasm_f32x4_splat(0.0f), lejos = wasm_f32x4_splat(BARRIDO_LEJOS), menosLejos = wasm_f32x4_splat(-BARRIDO_LEJOS);
+    auto eje = [&](float a0, float aw, float am, v128_t b0, v128_t bw, v128_t bm, v128_t& lo, v128_t& hi) {
+        v128_t va = wasm_f32x4_splat(aw);
+        v128_t dd = wasm_f32x4_sub(bm, wasm_f32x4_splat(am));
+        v128_t d0 = wasm_f32x4_sub(wasm_f32x4_sub(b0, wasm_f32x4_splat(a0)), dd);
+        v128_t menosB = wasm_f32x4_sub(cero, bw);
+        v128_t t0 = wasm_f32x4_div(wasm_f32x4_sub(menosB, d0), dd), t1 = wasm_f32x4_div(wasm_f32x4_sub(va, d0), dd);
+        v128_t quieto = wasm_f32x4_eq(dd, cero);
+        v128_t dentro = wasm_v128_and(wasm_f32x4_gt(d0, menosB), wasm_f32x4_lt(d0, va));
+        lo = wasm_v128_bitselect(wasm_v128_bitselect(menosLejos, lejos, dentro), wasm_f32x4_pmin(t0, t1), quieto);
+        hi = wasm_v128_bitselect(wasm_v128_bitselect(lejos, menosLejos, dentro), wasm_f32x4_pmax(t0, t1), quieto);
+    };
+    unsigned mask = 0;
+    for (int k = 0; k < LOTE_AABB; k += 4) {
+        v128_t lox, hix, loy, hiy;
+        eje(a.x, a.width, amx, wasm_v128_load(x + k), wasm_v128_load(w + k), wasm_v128_load(mx + k), lox, hix);
+        eje(a.y, a.height, amy, wasm_v128_load(y + k), wasm_v128_load(h + k), wasm_v128_load(my + k), loy, hiy);
+        v128_t lo = wasm_f32x4_pmax(lox, loy), hi = wasm_f32x4_pmin(hix, hiy);
+        v128_t c = wasm_v128_and(wasm_v128_and(wasm_f32x4_lt(lo, hi), wasm_f32x4_lt(lo, wasm_f32x4_splat(1.0f))), wasm_f32x4_gt(hi, cero));
+        mask |= (unsigned)wasm_i32x4_bitmask(c) << k;
+    }
+    return mask & ((1u << n) - 1);
+#else
+    return BarridoContraLoteEscalar(a, amx, amy, x, y, w, h, mx, my, n);
+#endif
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "mivector.h"
+#include "world.h"
+
+// ------------------------------------------
+// PARTE 7: SNAPSHOTS Y REBOBINADO
+// ------------------------------------------
+//Como las entidades ya estan en arreglos por campo, una foto del mundo es una cabecera y despues
+//cada arreglo copiado tal cual con memcpy (nada de recorrer entidades). Entra todo lo que decide los
+//ticks siguientes: posiciones, velocidades, formas, vidas de las balas, rotacion e invulnerabilidad de
+//los jugadores, stats y el estado del generador. La broadphase no: se vuelve a armar en el proximo step.
+//
+//El buffer de cada foto crece hasta el tamanio mas grande que vio y despues se reutiliza, asi que en
+//una partida normal capturar no pide memoria.
+//
+//Restaurar deja el mismo hashEstado(), y seguir jugando desde ahi da lo mismo que la primera vez con
+//cualquier broadphase: la broadphase nueva tiene otra historia (otros ids de proxy, otros nodos), pero
+//World::colisiones ordena los pares por indice de entidad antes de resolver los choques.
+
+struct CabeceraSnapshot {
+    uint32_t tick; //lo pone el que captura (en el juego: ticks grabados en el InputLog)
+    uint32_t semilla;
+    uint64_t rng;
+    float tiempoJuego;
+    int32_t balasDisparadas, vecesPerdidas, asteroidesVivos;
+    uint32_t modoBot;
+    uint32_t jugadores, asteroides, balas;
+};
+
+class Snapshot {
+private:
+    MiVector<unsigned char> datos;
+    size_t usados = 0;
+
+    template <typename T>
+    void escribir(size_t& pos, const MiVector<T>& v) {
+        if (v.size()) memcpy(&datos[pos], v.data(), v.size() * sizeof(T));
+        pos += v.size() * sizeof(T);
+    }
+    template <typename T>
+    void leer(size_t& pos, MiVector<T>& v, size_t n) const { //n entra en la capacidad del pool: no pide memoria
+        v.resize(n);
+        if (n) memcpy(v.data(), &datos[pos], n * sizeof(T));
+        pos += n * sizeof(T);
+    }
+
+    static size_t BytesJugador() { return 6 * sizeof(float) + sizeof(bool); }
+    static size_t BytesAsteroide() { return 5 * sizeof(float) + sizeof(int) + sizeof(uint16_t); } //la forma es un indice en la biblioteca
+    static size_t BytesBala() { return 5 * sizeof(float); }
+
+public:
+    const unsigned char* bytes() const { return datos.data(); } //la foto entera, lista para escribir a disco
+    size_t tamanio() const { return usados; }
+    bool vacio() const { return usados == 0; }
+
+    CabeceraSnapshot cabecera() const {
+        CabeceraSnapshot c;
+        memcpy(&c, datos.data(), sizeof(c));
+        return c;
+    }
+
+    void capturar(const World& w, uint32_t tick) {
+        const Jugadores& J = w.jugadores;
+        const Asteroides& A = w.asteroides;
+        const Balas& B = w.balas;
+        CabeceraSnapshot c = { tick, w.semilla, w.rng.s, w.tiempoJuego, w.balasDisparadas, w.vecesPerdidas,
+                               w.asteroidesVivos, w.modoBot ? 1u : 0u,
+                               (uint32_t)J.count(), (uint32_t)A.count(), (uint32_t)B.count() };
+        usados = sizeof(c) + J.count() * BytesJugador() + A.count() * BytesAsteroide() + B.count() * BytesBala();
+        if (datos.size() < usados) datos.resize(usados); //solo la primera vez (o si la escena crece)
+
+        size_t pos = 0;
+        memcpy(&datos[pos], &c, sizeof(c)); pos += sizeof(c);
+        escribir(pos, J.x); escribir(pos, J.y); escribir(pos, J.vx); escribir(pos, J.vy);
+        escribir(pos, J.rotation); escribir(pos, J.invulnerabilityTime); escribir(pos, J.esBot);
+        escribir(pos, A.x); escribir(pos, A.y); escribir(pos, A.vx); escribir(pos, A.vy); escribir(pos, A.w);
+        escribir(pos, A.sizeLevel); escribir(pos, A.forma);
+        escribir(pos, B.x); escribir(pos, B.y); escribir(pos, B.vx); escribir(pos, B.vy); escribir(pos, B.lifeTime);
+    }
+
+    //deja el mundo como estaba al capturar; devuelve el tick de la foto
+    uint32_t restaurar(World& w) const {
+        CabeceraSnapshot c = cabecera();
+        Jugadores& J = w.jugadores;
+        Asteroides& A = w.asteroides;
+        Balas& B = w.balas;
+        w.broadphase->clear();
+        w.primerAsteroideNuevo = 0; //ninguno esta en la broadphase hasta el proximo step
+        w.semilla = c.semilla; w.rng.s = c.rng;
+        w.tiempoJuego = c.tiempoJuego;
+        w.balasDisparadas = c.balasDisparadas; w.vecesPerdidas = c.vecesPerdidas; w.asteroidesVivos = c.asteroidesVivos;
+        w.modoBot = c.modoBot != 0;
+
+        size_t pos = sizeof(c);
+        leer(pos, J.x, c.jugadores); leer(pos, J.y, c.jugadores); leer(pos, J.vx, c.jugadores); leer(pos, J.vy, c.jugadores);
+        leer(pos, J.rotation, c.jugadores); leer(pos, J.invulnerabilityTime, c.jugadores); leer(pos, J.esBot, c.jugadores);
+        J.acceleration.resize(c.jugadores); J.friction.resize(c.jugadores); J.proxy.resize(c.jugadores);
+        for (size_t j = 0; j < c.jugadores; j++) { //constantes segun el tipo de jugador (ver Jugadores::push)
+            J.acceleration[j] = J.esBot[j] ? 1100.0f : 1000.0f;
+            J.friction[j] = J.esBot[j] ? 0.75f : 0.98f;
+            J.proxy[j] = -1;
+        }
+        leer(pos, A.x, c.asteroides); leer(pos, A.y, c.asteroides); leer(pos, A.vx, c.asteroides); leer(pos, A.vy, c.asteroides);
+        leer(pos, A.w, c.asteroides); leer(pos, A.sizeLevel, c.asteroides); leer(pos, A.forma, c.asteroides);
+        A.active.resize(c.asteroides); A.proxy.resize(c.asteroides);
+        for (size_t i = 0; i < c.asteroides; i++) { A.active[i] = true; A.proxy[i] = -1; }
+        leer(pos, B.x, c.balas); leer(pos, B.y, c.balas); leer(pos, B.vx, c.balas); leer(pos, B.vy, c.balas);
+        leer(pos, B.lifeTime, c.balas);
+        B.x0.resize(c.balas); B.y0.resize(c.balas); //se pisan al principio del proximo paso
+        B.active.resize(c.balas); B.proxy.resize(c.balas);
+        for (size_t i = 0; i < c.balas; i++) { B.active[i] = true; B.proxy[i] = -1; }
+        w.contornosSucios = true;
+        return c.tick;
+    }
+};
+
+//Las ultimas N fotos en un anillo de tamanio fijo: al llenarse, cada captura pisa la mas vieja.
+//Se captura despues de cada step (y una vez al empezar), asi la foto mas nueva es siempre el estado actual.
+class HistorialSnapshots {
+private:
+    MiVector<Snapshot> fotos;
+    size_t siguiente = 0; //donde va la proxima captura
+    size_t cantidad = 0;
+
+public:
+    explicit HistorialSnapshots(size_t capacidad = 60 * 10) { fotos.resize(capacidad); } //10 s a 60 Hz
+
+    size_t capacidad() const { return fotos.size(); }
+    size_t size() const { return cantidad; }
+    bool empty() const { return cantidad == 0; }
+    void clear() { siguiente = 0; cantidad = 0; } //los buffers se conservan
+
+    void capturar(const World& w, uint32_t tick) {
+        fotos[siguiente].capturar(w, tick);
+        siguiente = (siguiente + 1) % fotos.size();
+        if (cantidad < fotos.size()) cantidad++;
+    }
+
+    const Snapshot& ultima() const { return fotos[(siguiente + fotos.size() - 1) % fotos.size()]; }
+
+    bool puedeRetroceder() const { return cantidad > 1; } //hay algo antes del estado actual
+
+    //Un tick para atras: saca la foto mas nueva (la del estado actual) y restaura la anterior, que queda
+    //como la mas nueva. Mantener apretado = ir hacia atras tick por tick. Solo si puedeRetroceder().
+    uint32_t retroceder(World& w) {
+        siguiente = (siguiente + fotos.size() - 1) % fotos.size();
+        cantidad--;
+        return ultima().restaurar(w);
+    }
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "mivector.h"
+#include "geometria.h"
+#include "broadphase.h"
+
+// ------------------------------------------
+// PARTE 3.3: SORT AND SWEEP
+// ------------------------------------------
+//Mantiene los ids ordenados por el borde izquierdo (x). Una consulta hace busqueda binaria y recorre
+//solo la franja de objetos cuyo intervalo en x se solapa con el de la consulta. Como de un frame a
+//otro casi nada cambia de orden, se reordena con insercion (casi O(n)); si entraron muchos objetos
+//nuevos de golpe se usa std::sort.
+
+class SortAndSweep : public Broadphase {
+private:
+    ProxyTable tabla;
+    MiVector<int> orden; //ids vivos ordenados por bounds.x
+    MiVector<int> liberados; //ids removidos que siguen en 'orden' hasta compactar
+    float maxWidth; //caja mas ancha; limita hacia atras la busqueda
+    int nuevos; //ids agregados al final de 'orden' desde el ultimo ordenamiento
+    bool sucio;
+
+    float minX(int id) const { return tabla.items[id].bounds.x; }
+
+    size_t primeroDesde(float x) const { //primera posicion de 'orden' con bounds.x >= x
+        size_t lo = 0, hi = orden.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (minX(orden[mid]) < x) lo = mid + 1; else hi = mid;
+        }
+        return lo;
+    }
+
+    void ordenar() {
+        if (!sucio) return;
+        if (!liberados.empty()) { //saca los ids muertos y recien ahi los deja reutilizar
+            size_t k = 0;
+            for (size_t i = 0; i < orden.size(); i++) if (tabla.alive[orden[i]]) orden[k++] = orden[i];
+            orden.resize(k);
+            for (size_t i = 0; i < liberados.size(); i++) tabla.release(liberados[i]);
+            liberados.clear();
+        }
+        if (nuevos > (int)orden.size() / 8 + 8) {
+            std::sort(orden.begin(), orden.end(), [&](int a, int b) { return minX(a) < minX(b); });
+        } else {
+            for (size_t i = 1; i < orden.size(); i++) { //insercion: barato si ya esta casi ordenado
+                int id = orden[i];
+                float key = minX(id);
+                size_t j = i;
+                while (j > 0 && minX(orden[j - 1]) > key) { orden[j] = orden[j - 1]; j--; }
+                orden[j] = id;
+            }
+        }
+        maxWidth = 0;
+        for (size_t i = 0; i < orden.size(); i++) {
+            float w = tabla.items[orden[i]].bounds.width;
+            if (w > maxWidth) maxWidth = w;
+        }
+        nuevos = 0;
+        sucio = false;
+    }
+
+public:
+    SortAndSweep() : maxWidth(0), nuevos(0), sucio(true) {}
+
+    const char* nombre() const override { return "sap"; }
+
+    void clear() override { tabla.clear(); orden.clear(); liberados.clear(); nuevos = 0; sucio = true; }
+
+    void reservar(size_t n) override { tabla.reservar(n); orden.reserve(n); liberados.reserve(n); }
+
+    int insert(const BroadItem& item) override {
+        int id = tabla.add(item);
+        orden.push_back(id);
+        nuevos++;
+        sucio = true;
+        return id;
+    }
+
+    void move(int id, const Rect& newBounds) override {
+        tabla.items[id].bounds = newBounds;
+        sucio = true;
+    }
+
+    void remove(int id) override {
+        tabla.kill(id);
+        liberados.push_back(id);
+        sucio = true;
+    }
+
+    void setRef(int id, EntityRef ref) override { tabla.items[id].ref = ref; }
+
+    bool query(const Rect& r, Visitante visita) override {
+        ordenar();
+        float hasta = r.x + r.width;
+        for (size_t i = primeroDesde(r.x - maxWidth); i < orden.size(); i++) {
+            const BroadItem& it = tabla.items[orden[i]];
+            if (it.bounds.x >= hasta) break; //de aqui en adelante ya todo empieza despues de la consulta
+            if (SeSolapan(it.bounds, r) && !visita(it)) return false;
+        }
+        return true;
+    }
+
+    //Desde px hacia los dos lados por orden de x; un centro esta entre x y x + maxWidth/2 del borde
+    //izquierdo, asi que cada lado se corta cuando solo la distancia en x ya supera al k-esimo.
+    int nearest(float px, float py, TipoEntidad tipo, int k, Vecino* out) override {
+        ordenar();
+        int n = 0;
+        if (k <= 0) return 0;
+        size_t medio = primeroDesde(px);
+        for (size_t i = medio; i < orden.size(); i++) {
+            const BroadItem& it = tabla.items[orden[i]];
+            float dx = it.bounds.x - px;
+            if (n == k && dx * dx > out[k - 1].dist2) break;
+            if (it.ref.tipo == tipo) AgregarVecino(out, n, k, it.ref, Dist2Centro(it.bounds, px, py));
+        }
+        for (size_t i = medio; i-- > 0;) {
+            const BroadItem& it = tabla.items[orden[i]];
+            float dx = px - (it.bounds.x + maxWidth / 2);
+            if (n == k && dx > 0 && dx * dx > out[k - 1].dist2) break;
+            if (it.ref.tipo == tipo) AgregarVecino(out, n, k, it.ref, Dist2Centro(it.bounds, px, py));
+        }
+        return n;
+    }
+
+    //Recorre 'orden' en el sentido en que avanza el rayo en x, desde el origen: en cuanto los bordes
+    //izquierdos quedan mas alla de lo que el rayo recorre hasta el mejor impacto (o tMax), se corta.
+    bool raycast(float ox, float oy, float dx, float dy, float tMax, TipoEntidad tipo, Impacto& hit) override {
+        ordenar();
+        bool hay = false;
+        float invX = 1.0f / dx, invY = 1.0f / dy, t;
+        if (dx >= 0) {
+            for (size_t i = primeroDesde(ox - maxWidth); i < orden.size(); i++) {
+                const BroadItem& it = tabla.items[orden[i]];
+                if ((it.bounds.x - ox) * invX > (hay ? hit.t : tMax)) break; //mismo calculo que RayoCaja: los empates no se pierden
+                if (it.ref.tipo == tipo && RayoCaja(ox, oy, invX, invY, it.bounds, tMax, t)) MejorImpacto(hit, hay, it.ref, t);
+            }
+        } else {
+            for (size_t i = primeroDesde(std::nextafter(ox, 1e30f)); i-- > 0;) { //los que empiezan en x <= ox, de derecha a izquierda
+                const BroadItem& it = tabla.items[orden[i]];
+                if ((it.bounds.x + maxWidth - ox) * invX > (hay ? hit.t : tMax)) break;
+                if (it.ref.tipo == tipo && RayoCaja(ox, oy, invX, invY, it.bounds, tMax, t)) MejorImpacto(hit, hay, it.ref, t);
+            }
+        }
+        return hay;
+    }
+
+    //Barrido clasico: cada objeto solo mira hacia adelante mientras los siguientes empiecen antes de
+    //que el termine, asi cada par con solape en x sale una vez. Cada posicion de 'orden' es una tarea.
+    void prepararPares() override { ordenar(); }
+    size_t tareasPares() const override { return orden.size(); }
+
+    void paresTarea(size_t desde, size_t hasta, MiVector<ColPair>& pares) const override {
+        size_t n = orden.size();
+        for (size_t i = desde; i < hasta && !lleno(pares); i++) {
+            const BroadItem& p = tabla.items[orden[i]];
+            float finP = p.bounds.x + p.bounds.width;
+            for (size_t j = i + 1; j < n; j++) {
+                const BroadItem& q = tabla.items[orden[j]];
+                if (q.bounds.x >= finP) break;
+                if (p.ref.tipo == TIPO_ASTEROIDE && q.ref.tipo == TIPO_ASTEROIDE) continue;
+                emitir(pares, p, q);
+            }
+        }
+    }
+
+    int nodeCount() const override { return (int)orden.size(); }
+};
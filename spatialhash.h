@@ -0,0 +1,284 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "mivector.h"
+#include "geometria.h"
+#include "broadphase.h"
+
+// ------------------------------------------
+// PARTE 3.2: GRILLA UNIFORME (SPATIAL HASH)
+// ------------------------------------------
+//Celdas de 64 px: el asteroide mas grande mide 60 (radio 30) y ocupa a lo mas 2x2 celdas, y una
+//consulta nunca arrastra subarboles enteros como el quadtree con los que quedan sobre una linea de
+//division. Las coordenadas de celda se hashean a una tabla fija de cubetas.
+//
+//Las balas entran con la caja barrida de todo el paso mas lo que puede moverse un asteroide (ver
+//World::sincronizarBroadphase): (BULLET_SPEED + 2 * ASTEROIDE_VEL_MAX) * dt + BULLET_SIZE por eje, 33 px
+//a 60 Hz y 62 px a 30 Hz, todavia 2x2. Con un dt mas largo (headless --dt) pasa de 64 px y toca mas
+//celdas: las primeras CELDAS_DIRECTAS de cada objeto tienen su lugar anotado y el resto se busca en la
+//cubeta al sacarlo (quitarCeldas). Esa busqueda no sobra: sin ella no se podrian sacar ni mover esas balas.
+//
+//Cada cubeta es una lista corta de (id, celda). move() solo toca la tabla si el objeto cambio de celdas:
+//saca sus entradas de las cubetas viejas y las agrega en las nuevas, sin rearmar nada mas.
+
+class SpatialHash : public Broadphase {
+private:
+    static const int CELL_SIZE = 64;
+    static const int BUCKETS = 1024; //potencia de 2 para usar & en vez de %
+
+    static const int CELDAS_DIRECTAS = 4; //celdas por objeto con lugar anotado (2x2, lo normal; ver arriba)
+
+    struct EntradaCelda {
+        int id;
+        int cx, cy; //celda real (varias celdas pueden caer en la misma cubeta)
+        int k; //que celda del objeto es (en el orden de forCeldas)
+    };
+    typedef MiVector<EntradaCelda> Cubeta;
+
+    ProxyTable tabla;
+    MiVector<Cubeta> cubetas; //BUCKETS listas
+    MiVector<int> lugar; //lugar[id * CELDAS_DIRECTAS + k] = posicion en su cubeta de la k-esima entrada del objeto
+    int entradas; //total de entradas (un objeto cuenta una vez por celda)
+    MiVector<int> ocupadas; //cubetas no vacias, para que findPairs no recorra las 1024
+    MiVector<int> posOcupada; //lugar de cada cubeta en 'ocupadas' (-1 = vacia)
+    MiVector<unsigned> visto; //marca por id para no devolver dos veces el mismo objeto en una consulta
+    unsigned consulta;
+    int cxMin, cxMax, cyMin, cyMax; //celdas que alguna vez tuvieron algo desde clear(); fuera no hay nada que buscar
+
+    static int celda(float v) { return (int)floorf(v / CELL_SIZE); }
+
+    static int hashCelda(int cx, int cy) {
+        unsigned h = (unsigned)cx * 73856093u ^ (unsigned)cy * 19349663u;
+        return (int)(h & (BUCKETS - 1));
+    }
+
+    template <typename F>
+    static void forCeldas(const Rect& r, F f) { //recorre las cubetas de todas las celdas que toca r
+        int cx0 = celda(r.x), cx1 = celda(r.x + r.width);
+        int cy0 = celda(r.y), cy1 = celda(r.y + r.height);
+        for (int cy = cy0; cy <= cy1; cy++)
+            for (int cx = cx0; cx <= cx1; cx++) f(hashCelda(cx, cy), cx, cy);
+    }
+
+    static bool mismasCeldas(const Rect& a, const Rect& b) {
+        return celda(a.x) == celda(b.x) && celda(a.x + a.width) == celda(b.x + b.width) &&
+               celda(a.y) == celda(b.y) && celda(a.y + a.height) == celda(b.y + b.height);
+    }
+
+    void agregarCeldas(int id, const Rect& r) {
+        int k = 0;
+        forCeldas(r, [&](int b, int cx, int cy) {
+            Cubeta& c = cubetas[b];
+            if (c.empty()) { posOcupada[b] = (int)ocupadas.size(); ocupadas.push_back(b); }
+            if (k < CELDAS_DIRECTAS) lugar[id * CELDAS_DIRECTAS + k] = (int)c.size();
+            c.push_back({ id, cx, cy, k++ });
+            entradas++;
+            cxMin = std::min(cxMin, cx); cxMax = std::max(cxMax, cx);
+            cyMin = std::min(cyMin, cy); cyMax = std::max(cyMax, cy);
+        });
+    }
+
+    //Cada entrada sabe su lugar (lugar[]), asi que sacarla es O(1) aunque la cubeta tenga muchas; solo las
+    //de objetos de mas de CELDAS_DIRECTAS celdas se buscan. La ultima de la cubeta ocupa el hueco.
+    void quitarCeldas(int id, const Rect& r) {
+        int k = 0;
+        forCeldas(r, [&](int b, int cx, int cy) {
+            Cubeta& c = cubetas[b];
+            size_t i = 0;
+            if (k < CELDAS_DIRECTAS) i = (size_t)lugar[id * CELDAS_DIRECTAS + k];
+            else while (c[i].id != id || c[i].cx != cx || c[i].cy != cy) i++;
+            k++;
+            if (i + 1 != c.size()) {
+                c[i] = c.back();
+                if (c[i].k < CELDAS_DIRECTAS) lugar[c[i].id * CELDAS_DIRECTAS + c[i].k] = (int)i;
+            }
+            c.pop_back();
+            entradas--;
+            if (c.empty() && posOcupada[b] != -1) { //swap-and-pop en 'ocupadas'
+                int p = posOcupada[b], ultima = ocupadas.back();
+                ocupadas[p] = ultima; posOcupada[ultima] = p;
+                ocupadas.pop_back(); posOcupada[b] = -1;
+            }
+        });
+    }
+
+    template <typename F>
+    void forCelda(int cx, int cy, F f) const { //ids registrados en esa celda (no en las otras de su cubeta)
+        const Cubeta& c = cubetas[hashCelda(cx, cy)];
+        for (size_t k = 0; k < c.size(); k++) {
+            if (c[k].cx == cx && c[k].cy == cy) f(c[k].id);
+        }
+    }
+
+    bool celdaOcupada(int cx, int cy) const { //como forCelda, pero corta en la primera entrada de la celda
+        const Cubeta& c = cubetas[hashCelda(cx, cy)];
+        for (size_t k = 0; k < c.size(); k++) {
+            if (c[k].cx == cx && c[k].cy == cy) return true;
+        }
+        return false;
+    }
+
+    void vaciar() {
+        for (int b = 0; b < BUCKETS; b++) { cubetas[b].clear(); posOcupada[b] = -1; }
+        ocupadas.clear();
+        entradas = 0;
+        cxMin = cyMin = 1 << 30; cxMax = cyMax = -(1 << 30);
+    }
+
+public:
+    SpatialHash() : entradas(0), consulta(0) {
+        cubetas.resize(BUCKETS);
+        posOcupada.resize(BUCKETS);
+        ocupadas.reserve(BUCKETS);
+        vaciar();
+    }
+
+    const char* nombre() const override { return "grid"; }
+
+    void clear() override { tabla.clear(); visto.clear(); lugar.clear(); vaciar(); }
+
+    //ademas de los ids, cada cubeta toma de una vez lugar para varias entradas: en una partida un par de
+    //celdas juntan muchas balas y no deberian crecer despues de la primera
+    void reservar(size_t n) override {
+        tabla.reservar(n); visto.reserve(n); lugar.reserve(n * CELDAS_DIRECTAS);
+        for (int b = 0; b < BUCKETS; b++) cubetas[b].reserve(16);
+    }
+
+    int insert(const BroadItem& item) override {
+        int id = tabla.add(item);
+        if ((size_t)id >= visto.size()) visto.push_back(0);
+        if (lugar.size() < visto.size() * CELDAS_DIRECTAS) lugar.resize(visto.size() * CELDAS_DIRECTAS);
+        agregarCeldas(id, item.bounds);
+        return id;
+    }
+
+    void move(int id, const Rect& newBounds) override {
+        Rect& old = tabla.items[id].bounds;
+        if (!mismasCeldas(old, newBounds)) { //solo lo que cambio de celdas toca las cubetas
+            quitarCeldas(id, old);
+            agregarCeldas(id, newBounds);
+        }
+        old = newBounds;
+    }
+
+    void remove(int id) override {
+        quitarCeldas(id, tabla.items[id].bounds);
+        tabla.kill(id);
+        tabla.release(id); //ya no esta en ninguna cubeta, el id se puede reutilizar
+    }
+
+    void setRef(int id, EntityRef ref) override { tabla.items[id].ref = ref; }
+
+    //Solo las celdas de r que caen dentro de las ocupadas: una consulta enorme o fuera de pantalla no
+    //recorre celdas vacias. Un objeto en varias celdas se visita una vez (marca 'visto').
+    bool query(const Rect& r, Visitante visita) override {
+        if (cxMax < cxMin) return true;
+        consulta++;
+        int cx0 = std::max(celda(r.x), cxMin), cx1 = std::min(celda(r.x + r.width), cxMax);
+        int cy0 = std::max(celda(r.y), cyMin), cy1 = std::min(celda(r.y + r.height), cyMax);
+        bool seguir = true;
+        for (int cy = cy0; cy <= cy1 && seguir; cy++) {
+            for (int cx = cx0; cx <= cx1 && seguir; cx++) {
+                forCelda(cx, cy, [&](int id) {
+                    if (!seguir || visto[id] == consulta || !tabla.alive[id]) return;
+                    visto[id] = consulta;
+                    if (SeSolapan(tabla.items[id].bounds, r)) seguir = visita(tabla.items[id]);
+                });
+            }
+        }
+        return seguir;
+    }
+
+    //Anillos de celdas alrededor de la del punto. Terminado el anillo r, todo lo que falta tiene el centro
+    //en una celda de afuera, a mas de r * CELL_SIZE (mas lo que falte hasta el borde de la celda del
+    //punto): si el k-esimo esta mas cerca ya no hay que seguir. Solo dentro de las celdas ocupadas.
+    int nearest(float px, float py, TipoEntidad tipo, int k, Vecino* out) override {
+        int n = 0;
+        if (k <= 0 || cxMax < cxMin) return 0;
+        consulta++;
+        int c0x = celda(px), c0y = celda(py);
+        int rMax = std::max(std::max(c0x - cxMin, cxMax - c0x), std::max(c0y - cyMin, cyMax - c0y));
+        float fx = px - c0x * CELL_SIZE, fy = py - c0y * CELL_SIZE; //posicion dentro de su celda
+        float borde = std::min(std::min(fx, CELL_SIZE - fx), std::min(fy, CELL_SIZE - fy));
+        auto probar = [&](int cx, int cy) {
+            if (cx < cxMin || cx > cxMax || cy < cyMin || cy > cyMax) return; //seguro vacia
+            forCelda(cx, cy, [&](int id) {
+                if (visto[id] == consulta || !tabla.alive[id]) return;
+                visto[id] = consulta;
+                if (tabla.items[id].ref.tipo == tipo) AgregarVecino(out, n, k, tabla.items[id].ref, Dist2Centro(tabla.items[id].bounds, px, py));
+            });
+        };
+        for (int r = 0; r <= rMax; r++) {
+            if (r == 0) probar(c0x, c0y);
+            for (int i = -r; i <= r && r > 0; i++) { //borde del cuadrado de lado 2r+1
+                probar(c0x + i, c0y - r); probar(c0x + i, c0y + r);
+                if (i != -r && i != r) { probar(c0x - r, c0y + i); probar(c0x + r, c0y + i); }
+            }
+            float alcance = r * CELL_SIZE + borde; //distancia minima a cualquier celda fuera del cuadrado
+            if (n == k && out[k - 1].dist2 < alcance * alcance) break;
+        }
+        return n;
+    }
+
+    //Recorre las celdas que cruza el rayo en orden (DDA); se corta cuando la celda empieza despues del
+    //mejor impacto. Un objeto grande puede aparecer en varias celdas: probarlo dos veces da lo mismo.
+    bool raycast(float ox, float oy, float dx, float dy, float tMax, TipoEntidad tipo, Impacto& hit) override {
+        bool hay = false;
+        if (cxMax < cxMin) return false;
+        float invX = 1.0f / dx, invY = 1.0f / dy;
+        int cx = celda(ox), cy = celda(oy);
+        int pasoX = dx > 0 ? 1 : -1, pasoY = dy > 0 ? 1 : -1;
+        const float INF = 1e30f;
+        float tX = dx != 0 ? ((cx + (dx > 0 ? 1 : 0)) * (float)CELL_SIZE - ox) * invX : INF; //t del proximo borde vertical
+        float tY = dy != 0 ? ((cy + (dy > 0 ? 1 : 0)) * (float)CELL_SIZE - oy) * invY : INF;
+        float deltaX = dx != 0 ? CELL_SIZE * fabsf(invX) : INF, deltaY = dy != 0 ? CELL_SIZE * fabsf(invY) : INF;
+        float tCelda = 0; //donde el rayo entra en la celda actual
+        while (tCelda <= tMax && !(hay && tCelda > hit.t)) {
+            if ((pasoX > 0 && cx > cxMax) || (pasoX < 0 && cx < cxMin) || (pasoY > 0 && cy > cyMax) || (pasoY < 0 && cy < cyMin)) break; //se fue de la zona ocupada
+            forCelda(cx, cy, [&](int id) {
+                const BroadItem& it = tabla.items[id];
+                float t;
+                if (tabla.alive[id] && it.ref.tipo == tipo && RayoCaja(ox, oy, invX, invY, it.bounds, tMax, t)) MejorImpacto(hit, hay, it.ref, t);
+            });
+            if (tX < tY) { tCelda = tX; tX += deltaX; cx += pasoX; }
+            else { tCelda = tY; tY += deltaY; cy += pasoY; }
+        }
+        return hay;
+    }
+
+    //Dos objetos que se solapan comparten varias celdas si son grandes; el par se emite solo desde la
+    //celda que contiene la esquina superior izquierda de la interseccion, asi sale una sola vez.
+    //Cada cubeta ocupada es una tarea.
+    size_t tareasPares() const override { return ocupadas.size(); }
+
+    void paresTarea(size_t desde, size_t hasta, MiVector<ColPair>& pares) const override {
+        for (size_t t = desde; t < hasta; t++) {
+            const Cubeta& c = cubetas[ocupadas[t]];
+            for (size_t i = 0; i < c.size() && !lleno(pares); i++) {
+                const BroadItem& p = tabla.items[c[i].id];
+                for (size_t j = i + 1; j < c.size(); j++) {
+                    if (c[i].cx != c[j].cx || c[i].cy != c[j].cy) continue; //otra celda, misma cubeta
+                    const BroadItem& q = tabla.items[c[j].id];
+                    if (p.ref.tipo == TIPO_ASTEROIDE && q.ref.tipo == TIPO_ASTEROIDE) continue;
+                    float ix = p.bounds.x > q.bounds.x ? p.bounds.x : q.bounds.x;
+                    float iy = p.bounds.y > q.bounds.y ? p.bounds.y : q.bounds.y;
+                    if (celda(ix) != c[i].cx || celda(iy) != c[i].cy) continue; //no es la celda duenia del par
+                    emitir(pares, p, q);
+                }
+            }
+        }
+    }
+
+    //celdas de pantalla que tienen algo: la cubeta la comparten otras celdas, hay que mirar sus entradas
+    void getAllBounds(MiVector<Rect>& list) const override {
+        for (int cy = -1; cy <= SCREEN_HEIGHT / CELL_SIZE; cy++)
+            for (int cx = -1; cx <= SCREEN_WIDTH / CELL_SIZE; cx++) {
+                if (celdaOcupada(cx, cy))
+                    list.push_back({ (float)(cx * CELL_SIZE), (float)(cy * CELL_SIZE), (float)CELL_SIZE, (float)CELL_SIZE });
+            }
+    }
+
+    int nodeCount() const override { return entradas; } //entradas en la tabla (un objeto cuenta una vez por celda)
+};
@@ -0,0 +1,807 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "mivector.h"
+#include "geometria.h"
+#include "broadphase.h"
+#include "quadtree.h"
+#include "spatialhash.h"
+#include "sortandsweep.h"
+#include "profiler.h"
+#include "simd.h"
+#include "jobs.h"
+
+// --------------------------------------
+// PARTE 4: ENTIDADES (STRUCTURE OF ARRAYS)
+// --------------------------------------
+//Cada tipo guarda sus campos en arreglos contiguos (uno por campo) en vez de un Entity* por objeto.
+//El tipo lo dice la etiqueta de EntityRef, asi que update y colisiones no usan virtuales ni dynamic_cast.
+//Ninguna funcion llama a GetFrameTime() ni a IsKeyDown(): el dt y la entrada llegan por parametro.
+
+const float BULLET_SIZE = 5.0f;
+const float BULLET_SPEED = 1100.0f;
+const float BULLET_LIFETIME = 0.45f; //desaparece despues de cierto tiempo
+const float PLAYER_SIZE = 20.0f;
+const float ASTEROIDE_VEL_MAX = 300.0f; //los chicos (ver spawnAsteroid); acota cuanto se mueve un asteroide en un paso
+
+//Asteroides y Balas funcionan como pools de capacidad fija: reservar() pide toda la memoria de una vez
+//y despues las altas y bajas solo mueven el contador. Como las bajas son swap-and-pop los arreglos
+//quedan densos y la lista libre es la cola [count, capacidad): cada alta toma el primer lugar libre.
+//Si una escena supera la capacidad el arreglo crece (eso si va al heap) y queda anotado en 'crecimientos'.
+struct PoolStats {
+    size_t peak = 0; //maximo de vivos a la vez
+    size_t recycled = 0; //altas que reutilizaron un lugar que ya habia usado otra entidad
+    size_t crecimientos = 0; //altas que no entraron en la capacidad reservada
+
+    void alta(size_t vivosAntes, size_t capacidad) {
+        if (vivosAntes < peak) recycled++;
+        if (vivosAntes >= capacidad) crecimientos++;
+        if (vivosAntes + 1 > peak) peak = vivosAntes + 1;
+    }
+};
+
+const int MAX_PUNTOS_FORMA = 12;
+
+struct AsteroidShape {
+    Vec2 points[MAX_PUNTOS_FORMA]; //Guardamos los "offsets" (distancias) desde el centro
+    int total;
+};
+
+struct Asteroides {
+    MiVector<float> x, y; //esquina superior izquierda de la caja
+    MiVector<float> vx, vy;
+    MiVector<float> w; //ancho = alto
+    MiVector<int> sizeLevel; // 3 = Grande, 2 = Mediano, 1 = Pequenio
+    MiVector<uint16_t> forma; //indice en la biblioteca de formas (ver Formas())
+    MiVector<bool> active; //false = destruido, se borra al aplicar los comandos del tick
+    MiVector<int> proxy; //id en la broadphase; -1 = todavia no se inserto
+    PoolStats stats;
+
+    size_t count() const { return x.size(); }
+    size_t capacity() const { return x.capacity(); }
+    Rect bounds(size_t i) const { return { x[i], y[i], w[i], w[i] }; }
+
+    void reservar(size_t n) {
+        x.reserve(n); y.reserve(n); vx.reserve(n); vy.reserve(n);
+        w.reserve(n); sizeLevel.reserve(n); forma.reserve(n); active.reserve(n); proxy.reserve(n);
+    }
+    void push(float _x, float _y, float _vx, float _vy, float _w, int _sizeLevel, uint16_t _forma) {
+        stats.alta(count(), capacity());
+        x.push_back(_x); y.push_back(_y); vx.push_back(_vx); vy.push_back(_vy);
+        w.push_back(_w); sizeLevel.push_back(_sizeLevel); forma.push_back(_forma); active.push_back(true);
+        proxy.push_back(-1);
+    }
+    void swapPop(size_t i) { //borrar en O(1): el ultimo ocupa el hueco (el orden de los arreglos no importa)
+        x.erase_unordered(i); y.erase_unordered(i); vx.erase_unordered(i); vy.erase_unordered(i);
+        w.erase_unordered(i); sizeLevel.erase_unordered(i); forma.erase_unordered(i); active.erase_unordered(i); proxy.erase_unordered(i);
+    }
+    void clear() {
+        x.clear(); y.clear(); vx.clear(); vy.clear();
+        w.clear(); sizeLevel.clear(); forma.clear(); active.clear(); proxy.clear();
+    }
+};
+
+struct Balas {
+    MiVector<float> x, y;
+    MiVector<float> x0, y0; //donde empezo el ultimo paso, antes de envolver (ver barrido)
+    MiVector<float> vx, vy;
+    MiVector<float> lifeTime;
+    MiVector<bool> active;
+    MiVector<int> proxy; //id en la broadphase; -1 = todavia no se inserto
+    PoolStats stats;
+
+    size_t count() const { return x.size(); }
+    size_t capacity() const { return x.capacity(); }
+    Rect bounds(size_t i) const { return { x[i], y[i], BULLET_SIZE, BULLET_SIZE }; }
+    //Caja al final del ultimo paso siguiendo el recorrido real desde (x0, y0). Si la bala salio por un
+    //borde, (x, y) ya esta del otro lado y reconstruir el comienzo como x - vx * dt daria un tramo que
+    //nunca recorrio; este sigue hasta afuera de la pantalla. Lo que toque donde reaparece se prueba en
+    //el paso siguiente, que empieza ahi.
+    Rect finalSinEnvolver(size_t i, float dt) const { return { x0[i] + vx[i] * dt, y0[i] + vy[i] * dt, BULLET_SIZE, BULLET_SIZE }; }
+    //caja de todo el recorrido del ultimo paso (de x0 a x0 + vx * dt) agrandada 'margen' por lado
+    Rect barrido(size_t i, float dt, float margen) const {
+        float xa = std::min(x0[i], x0[i] + vx[i] * dt), ya = std::min(y0[i], y0[i] + vy[i] * dt);
+        return { xa - margen, ya - margen, fabsf(vx[i]) * dt + BULLET_SIZE + 2 * margen, fabsf(vy[i]) * dt + BULLET_SIZE + 2 * margen };
+    }
+
+    void reservar(size_t n) {
+        x.reserve(n); y.reserve(n); x0.reserve(n); y0.reserve(n); vx.reserve(n); vy.reserve(n);
+        lifeTime.reserve(n); active.reserve(n); proxy.reserve(n);
+    }
+    void push(float _x, float _y, float _vx, float _vy) {
+        stats.alta(count(), capacity());
+        x.push_back(_x); y.push_back(_y); x0.push_back(_x); y0.push_back(_y); vx.push_back(_vx); vy.push_back(_vy);
+        lifeTime.push_back(BULLET_LIFETIME); active.push_back(true); proxy.push_back(-1);
+    }
+    void swapPop(size_t i) { //borrar en O(1): el ultimo ocupa el hueco (el orden de los arreglos no importa)
+        x.erase_unordered(i); y.erase_unordered(i); x0.erase_unordered(i); y0.erase_unordered(i);
+        vx.erase_unordered(i); vy.erase_unordered(i); lifeTime.erase_unordered(i); active.erase_unordered(i); proxy.erase_unordered(i);
+    }
+    void clear() {
+        x.clear(); y.clear(); x0.clear(); y0.clear(); vx.clear(); vy.clear(); lifeTime.clear(); active.clear(); proxy.clear();
+    }
+};
+
+struct Jugadores {
+    MiVector<float> x, y;
+    MiVector<float> vx, vy;
+    MiVector<float> rotation, acceleration, friction;
+    MiVector<float> invulnerabilityTime; //Si hay colision con asteroide
+    MiVector<bool> esBot; //el bot ignora el teclado y apunta solo
+    MiVector<int> proxy; //id en la broadphase; -1 = todavia no se inserto
+
+    size_t count() const { return x.size(); }
+    Rect bounds(size_t i) const { return { x[i], y[i], PLAYER_SIZE, PLAYER_SIZE }; }
+
+    void push(bool bot, float _x = SCREEN_WIDTH/2, float _y = SCREEN_HEIGHT/2) {
+        x.push_back(_x); y.push_back(_y); vx.push_back(0); vy.push_back(0);
+        rotation.push_back(0);
+        acceleration.push_back(bot ? 1100.0f : 1000.0f);
+        friction.push_back(bot ? 0.75f : 0.98f);
+        invulnerabilityTime.push_back(0.0f);
+        esBot.push_back(bot);
+        proxy.push_back(-1);
+    }
+    void clear() {
+        x.clear(); y.clear(); vx.clear(); vy.clear(); rotation.clear();
+        acceleration.clear(); friction.clear(); invulnerabilityTime.clear(); esBot.clear(); proxy.clear();
+    }
+};
+
+//Altas y bajas pedidas durante el tick. Nada se crea ni se borra mientras se recorren los arreglos:
+//World::aplicarComandos() lo hace todo junto al final del step.
+struct SpawnAsteroide { float x, y; int sizeLevel; };
+struct SpawnBala { float x, y, vx, vy; };
+
+struct CommandBuffer {
+    MiVector<SpawnAsteroide> spawnAsteroides;
+    MiVector<SpawnBala> spawnBalas;
+    MiVector<unsigned> destruirAsteroides, destruirBalas; //indices en los arreglos de cada tipo
+
+    void reservar(size_t asteroides, size_t balas) {
+        spawnAsteroides.reserve(asteroides); destruirAsteroides.reserve(asteroides);
+        spawnBalas.reserve(balas); destruirBalas.reserve(balas);
+    }
+    void clear() { spawnAsteroides.clear(); spawnBalas.clear(); destruirAsteroides.clear(); destruirBalas.clear(); }
+};
+
+inline Broadphase* CrearBroadphase(TipoBroadphase tipo) {
+    switch (tipo) {
+        case BP_GRID: return new SpatialHash();
+        case BP_SAP: return new SortAndSweep();
+        default: return new Quadtree(0, { 0, 0, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT });
+    }
+}
+
+//Generador propio de la partida (xorshift64*): con la misma semilla da la misma secuencia en cualquier
+//plataforma, cosa que rand() no garantiza, y al ser parte del World se puede guardar y restaurar.
+struct Rng {
+    uint64_t s;
+
+    explicit Rng(uint32_t semilla = 1) { sembrar(semilla); }
+    void sembrar(uint32_t semilla) { //splitmix64 para que semillas parecidas no den secuencias parecidas
+        uint64_t z = (uint64_t)semilla + 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        s = (z ^ (z >> 31)) | 1; //nunca 0
+    }
+    uint32_t siguiente() {
+        s ^= s >> 12; s ^= s << 25; s ^= s >> 27;
+        return (uint32_t)((s * 0x2545F4914F6CDD1Dull) >> 32);
+    }
+    int entero(int n) { return (int)(siguiente() % (uint32_t)n); } //en [0, n), reemplaza a rand() % n
+};
+
+//FNV-1a de 64 bits; los floats entran por sus bits, asi que cualquier diferencia cambia el hash
+struct HashFNV {
+    uint64_t h = 1469598103934665603ull;
+
+    void bytes(const void* p, size_t n) {
+        const unsigned char* b = (const unsigned char*)p;
+        for (size_t i = 0; i < n; i++) { h ^= b[i]; h *= 1099511628211ull; }
+    }
+    template <typename T> void valor(const T& v) { bytes(&v, sizeof(T)); }
+    template <typename T> void arreglo(const MiVector<T>& v) { if (v.size()) bytes(v.data(), v.size() * sizeof(T)); }
+};
+
+//Biblioteca de formas: FORMAS_POR_TAMANIO poligonos por sizeLevel, armados una sola vez (la primera vez
+//que se piden) con el mismo metodo que antes se usaba en cada alta: 8 a 12 puntos en circulo con el
+//radio +-30% al azar. Usa su propio Rng con semilla fija, asi las formas son las mismas en todas las
+//partidas y plataformas. Un asteroide nuevo (tambien al partirse) solo sortea cual usar: un rng y ningun
+//cos/sin, en vez de 14-18 rng y 8-12 pares cos/sin.
+const int FORMAS_POR_TAMANIO = 16;
+
+inline float RadioBase(int sizeLevel) { return (sizeLevel == 3) ? 30.0f : (sizeLevel == 2 ? 20.0f : 10.0f); }
+
+class BibliotecaFormas {
+private:
+    AsteroidShape formas[3 * FORMAS_POR_TAMANIO]; //las de sizeLevel s empiezan en (s - 1) * FORMAS_POR_TAMANIO
+
+public:
+    BibliotecaFormas() {
+        Rng rng(0xA57E801D);
+        for (int s = 1; s <= 3; s++) {
+            for (int k = 0; k < FORMAS_POR_TAMANIO; k++) {
+                AsteroidShape& shape = formas[indice(s, k)];
+                shape.total = 8 + rng.entero(5);
+                for (int i = 0; i < shape.total; i++) {
+                    float angle = (360.0f / shape.total) * i;
+                    float r = RadioBase(s) * (1.0f + (rng.entero(60) - 30) / 100.0f);
+                    shape.points[i].x = cos(angle * DEG2RAD) * r;
+                    shape.points[i].y = sin(angle * DEG2RAD) * r;
+                }
+            }
+        }
+    }
+    static uint16_t indice(int sizeLevel, int k) { return (uint16_t)((sizeLevel - 1) * FORMAS_POR_TAMANIO + k); }
+    const AsteroidShape& operator[](uint16_t i) const { return formas[i]; }
+};
+
+//se arma en la primera llamada (static local: thread-safe) y despues es de solo lectura, la comparten todos los World
+inline const BibliotecaFormas& Formas() {
+    static const BibliotecaFormas biblioteca;
+    return biblioteca;
+}
+
+//Contornos en pantalla de todos los asteroides, uno detras de otro, recalculados de una vez por tick (ver
+//World::prepararContornos): el render y cualquier prueba contra el poligono los leen sin volver a sumar
+//centro y offset.
+struct ContornosAsteroides {
+    MiVector<uint32_t> inicio; //los puntos del asteroide i son [inicio[i], inicio[i + 1])
+    MiVector<float> x, y;
+
+    size_t puntos() const { return x.size(); }
+    void reservar(size_t asteroides) {
+        inicio.reserve(asteroides + 1);
+        x.reserve(asteroides * MAX_PUNTOS_FORMA); y.reserve(asteroides * MAX_PUNTOS_FORMA);
+    }
+};
+
+// -----------------------------------------
+// PARTE 5: SIMULACION (WORLD)
+//Lo que se ajusta del bot. Los valores por defecto son los de siempre; las grabaciones no los guardan,
+//asi que se cambian solo para evaluar variantes en lote (ver partidas.h y headless --workers).
+struct ParametrosBot {
+    float radioEvasion = 180.0f; //si el asteroide mas cercano esta a menos, acelera para alejarse
+    float conoDisparo = 30.0f; //grados a cada lado del punto predicho en los que puede disparar
+    int probDisparo = 30; //% de los ticks en que dispara si puede
+    float adelanto = 1.0f; //fraccion del tiempo de vuelo de la bala que se adelanta el blanco (0 = al centro actual)
+    //tambien dispara fuera del cono si el rayo de la mira ya toca un asteroide (lineaDeTiro). Apagado
+    //por defecto: en 1000 partidas termina antes (18.7 s contra 21.5 s de promedio) pero gana menos (983 contra 992)
+    bool tiroEnLinea = false;
+};
+
+// -----------------------------------------
+//Todo el estado de una partida. step(dt, input) avanza un tick sin tocar ventana ni reloj,
+//el que llama decide el dt (GetFrameTime() en el juego, fijo en el headless).
+//El azar sale de 'rng': con la misma semilla, los mismos dt y las mismas teclas la partida se repite igual.
+
+class World {
+public:
+    Jugadores jugadores;
+    Asteroides asteroides;
+    Balas balas;
+    Broadphase* broadphase; //quadtree, grilla o sort-and-sweep; se cambia con setBroadphase()
+    TipoBroadphase tipoBroadphase;
+    bool modoBot;
+    Profiler* profiler; //opcional (no es duenio); si es nullptr step() no mide nada
+    JobSystem* jobs; //opcional (no es duenio); sin el, o en escenas chicas, todo corre en el hilo que llama
+    Rng rng; //formas, direcciones y disparos del bot
+    ContornosAsteroides contornos; //al dia con el ultimo tick despues de prepararContornos()
+    bool contornosSucios = true; //hubo un tick (o reset/restaurar) desde la ultima vez que se armaron
+    ParametrosBot parametrosBot;
+    uint32_t semilla; //la ultima que se paso a sembrar()
+    size_t maxPares = 0; //tope de pares candidatos por step (0 = sin tope); el juego no lo usa, es para bench
+
+    // VARIABLES DE ESTADISTICAS
+    int balasDisparadas;
+    float tiempoJuego;
+    int vecesPerdidas;
+    int asteroidesVivos; //del ultimo step; 0 = victoria
+    int testsNarrowphase; //pruebas de caja contra caja en el ultimo step
+    bool paresExcedidos = false; //el ultimo step paso maxPares y no resolvio ningun choque
+    size_t primerAsteroideNuevo; //desde este indice los asteroides todavia no estan en la broadphase
+
+    //las capacidades son las de los pools; toda la memoria de la partida se pide aqui y no en el juego
+    explicit World(size_t capAsteroides = 256, size_t capBalas = 256)
+        : broadphase(nullptr), tipoBroadphase(BP_QUADTREE), modoBot(false), profiler(nullptr), jobs(nullptr), semilla(1),
+          balasDisparadas(0), tiempoJuego(0.0f), vecesPerdidas(0), asteroidesVivos(0), testsNarrowphase(0),
+          primerAsteroideNuevo(0) {
+        asteroides.reservar(capAsteroides);
+        contornos.reservar(capAsteroides);
+        balas.reservar(capBalas);
+        comandos.reservar(capAsteroides, capBalas);
+        pares.reserve(capAsteroides + capBalas);
+        choques.reserve(capAsteroides + capBalas);
+        paresPorTarea.resize(MAX_TAREAS);
+        expiradasPorTarea.resize(MAX_TAREAS);
+        testsPorTarea.resize(MAX_TAREAS);
+        setBroadphase(BP_QUADTREE);
+    }
+    ~World() { delete broadphase; }
+
+    World(const World&) = delete; //MiVector no se puede copiar, el mundo tampoco
+    World& operator=(const World&) = delete;
+
+    //bots > 1 (solo con bot = true) pone un enjambre en circulo alrededor del centro, para pruebas de carga
+    void reset(bool bot, int bots = 1) { //antes ReiniciarJuego
+        jugadores.clear(); asteroides.clear(); balas.clear();
+        comandos.clear();
+        broadphase->clear();
+        modoBot = bot;
+
+        // RESETEAR STATS
+        balasDisparadas = 0;
+        tiempoJuego = 0.0f;
+        vecesPerdidas = 0;
+
+        if (!modoBot || bots <= 1) jugadores.push(modoBot);
+        for (int b = 0; modoBot && bots > 1 && b < bots; b++) {
+            float ang = 2 * PI * b / bots;
+            jugadores.push(true, SCREEN_WIDTH/2 + cosf(ang) * 150, SCREEN_HEIGHT/2 + sinf(ang) * 150);
+        }
+        primerAsteroideNuevo = 0;
+        for (int i = 0; i < 10; i++) { //Cantidad de ASTEROIDES
+            float x = rng.entero(SCREEN_WIDTH), y = rng.entero(SCREEN_HEIGHT);
+            if (fabsf(x - SCREEN_WIDTH/2) < 100) x += 200;
+            spawnAsteroid(x, y, 3);
+        }
+        asteroidesVivos = 10;
+        contornosSucios = true;
+    }
+
+    bool victoria() const { return asteroidesVivos == 0; }
+
+    void sembrar(uint32_t s) { semilla = s; rng.sembrar(s); } //antes de reset() para repetir una partida
+
+    //Resumen de todo lo que decide los ticks siguientes (entidades, stats y el estado del generador).
+    //La broadphase no entra: se reconstruye desde las entidades.
+    uint64_t hashEstado() const {
+        HashFNV f;
+        f.valor(jugadores.count()); f.valor(asteroides.count()); f.valor(balas.count());
+        f.arreglo(jugadores.x); f.arreglo(jugadores.y); f.arreglo(jugadores.vx); f.arreglo(jugadores.vy);
+        f.arreglo(jugadores.rotation); f.arreglo(jugadores.invulnerabilityTime);
+        f.arreglo(asteroides.x); f.arreglo(asteroides.y); f.arreglo(asteroides.vx); f.arreglo(asteroides.vy);
+        f.arreglo(asteroides.sizeLevel); f.arreglo(asteroides.forma);
+        f.arreglo(balas.x); f.arreglo(balas.y); f.arreglo(balas.vx); f.arreglo(balas.vy); f.arreglo(balas.lifeTime);
+        f.valor(balasDisparadas); f.valor(vecesPerdidas); f.valor(tiempoJuego); f.valor(rng.s);
+        return f.h;
+    }
+
+    void setBroadphase(TipoBroadphase tipo) { //cambia de backend en caliente
+        usarBroadphase(CrearBroadphase(tipo), tipo);
+    }
+
+    void usarBroadphase(Broadphase* bp, TipoBroadphase tipo) { //una broadphase armada afuera; World pasa a ser su duenio
+        delete broadphase;
+        broadphase = bp;
+        broadphase->reservar(asteroides.capacity() + balas.capacity() + 16);
+        tipoBroadphase = tipo;
+        primerAsteroideNuevo = 0;
+        //todos quedan sin proxy; el proximo step los inserta en la estructura nueva
+        for (size_t j = 0; j < jugadores.count(); j++) jugadores.proxy[j] = -1;
+        for (size_t i = 0; i < asteroides.count(); i++) asteroides.proxy[i] = -1;
+        for (size_t i = 0; i < balas.count(); i++) balas.proxy[i] = -1;
+    }
+
+    void spawnAsteroid(float x, float y, int sizeLevel) {
+        float baseRadius = RadioBase(sizeLevel); //radio del asteroide dependiendo de su tamanio
+        float speed = (sizeLevel == 3) ? 100 : (sizeLevel == 2 ? 200 : ASTEROIDE_VEL_MAX); //velocidad del asteroide dependiendo de su tamanio
+        float moveAngle = (float)rng.entero(360);
+        uint16_t forma = BibliotecaFormas::indice(sizeLevel, rng.entero(FORMAS_POR_TAMANIO));
+        asteroides.push(x, y, cos(moveAngle * DEG2RAD) * speed, sin(moveAngle * DEG2RAD) * speed,
+                        baseRadius * 2, sizeLevel, forma);
+        contornosSucios = true;
+    }
+
+    //Pasa la forma de cada asteroide a pantalla (centro + offset) de una vez, en arreglos seguidos, si
+    //cambio algo desde la ultima vez: el que dibuja lo llama cada frame y se arma a lo mas una vez por
+    //tick. Lo que no dibuja (headless, lotes de partidas) no paga nada. La cuenta de asteroides tambien
+    //se compara, por si alguien toco el pool sin pasar por World (escenas del bench).
+    const ContornosAsteroides& prepararContornos() {
+        if (contornosSucios || contornos.inicio.size() != asteroides.count() + 1) actualizarContornos();
+        return contornos;
+    }
+
+    void actualizarContornos() {
+        contornosSucios = false;
+        const BibliotecaFormas& formas = Formas();
+        size_t n = asteroides.count();
+        contornos.inicio.resize(n + 1);
+        uint32_t total = 0;
+        for (size_t i = 0; i < n; i++) { contornos.inicio[i] = total; total += formas[asteroides.forma[i]].total; }
+        contornos.inicio[n] = total;
+        contornos.x.resize(total); contornos.y.resize(total);
+        float* px = contornos.x.data();
+        float* py = contornos.y.data();
+        for (size_t i = 0; i < n; i++) {
+            const AsteroidShape& s = formas[asteroides.forma[i]];
+            float half = asteroides.w[i] / 2, cx = asteroides.x[i] + half, cy = asteroides.y[i] + half;
+            uint32_t k0 = contornos.inicio[i];
+            for (int k = 0; k < s.total; k++) { px[k0 + k] = cx + s.points[k].x; py[k0 + k] = cy + s.points[k].y; }
+        }
+    }
+
+    void shoot(size_t j) { //la bala sale del centro del jugador j (se crea al final del tick)
+        float cx = jugadores.x[j] + PLAYER_SIZE/2, cy = jugadores.y[j] + PLAYER_SIZE/2;
+        float angle = jugadores.rotation[j];
+        float vx = cos(angle * DEG2RAD) * BULLET_SPEED, vy = sin(angle * DEG2RAD) * BULLET_SPEED;
+        comandos.spawnBalas.push_back({ cx, cy, vx, vy });
+        // AUMENTAR CONTADOR DE BALAS
+        balasDisparadas++;
+    }
+
+    void step(float dt, const InputState& input) {
+        // AUMENTAR TIEMPO
+        tiempoJuego += dt;
+        dtPaso = dt;
+        paralelo = jobs && jobs->hilos() > 1 && asteroides.count() + balas.count() >= MIN_PARALELO;
+
+        // UPDATE
+        {
+            Profiler::Scope t(profiler, FASE_UPDATE);
+            for (size_t j = 0; j < jugadores.count(); j++) {
+                if (jugadores.esBot[j]) updateBot(j, dt);
+                else updateJugador(j, dt, input);
+            }
+            updateAsteroides(dt);
+            updateBalas(dt);
+        }
+
+        // BROADPHASE & COLISIONES
+        {
+            Profiler::Scope t(profiler, FASE_BROADPHASE);
+            sincronizarBroadphase();
+        }
+        {
+            Profiler::Scope t(profiler, FASE_COLISIONES);
+            colisiones();
+        }
+
+        // ALTAS Y BAJAS DEL TICK (lo que nacio aqui recien participa en el proximo)
+        {
+            Profiler::Scope t(profiler, FASE_LIMPIEZA);
+            aplicarComandos();
+            contornosSucios = true;
+        }
+        {
+            Profiler::Scope t(profiler, FASE_VICTORIA);
+            asteroidesVivos = (int)asteroides.count();
+        }
+
+        if (profiler) {
+            profiler->contador(CONT_ENTIDADES, (int)(jugadores.count() + asteroides.count() + balas.count()));
+            profiler->contador(CONT_NODOS, broadphase->nodeCount());
+            profiler->contador(CONT_PARES, (int)pares.size());
+            profiler->contador(CONT_TESTS, testsNarrowphase);
+        }
+    }
+
+private:
+    MiVector<ColPair> pares; //se reutiliza entre ticks para no pedir memoria cada vez
+    MiVector<unsigned char> choques; //resultado de la caja contra caja de cada par (1 = se tocan)
+
+    //Paralelismo: las partes por entidad (integrar, expirar balas, enumerar pares, probar cajas) se
+    //reparten en a lo mas MAX_TAREAS tareas; cada una deja lo suyo en su lugar de los arreglos *PorTarea
+    //y despues se junta en orden de tarea. Como el corte no depende de cuantos hilos hay, el resultado
+    //es el mismo con 1 hilo que con 16. Lo que toca estructuras compartidas (broadphase, comandos,
+    //stats) sigue en el hilo que llama.
+    static const size_t MIN_PARALELO = 4096; //con menos entidades repartir cuesta mas de lo que ahorra
+    static const size_t MAX_TAREAS = 64;
+    bool paralelo = false; //se decide al principio de cada step
+    float dtPaso = 0.0f; //dt del step en curso, para las pruebas barridas de las balas
+    MiVector<MiVector<ColPair>> paresPorTarea;
+    MiVector<MiVector<unsigned>> expiradasPorTarea;
+    MiVector<int> testsPorTarea;
+
+    template <typename F>
+    size_t repartir(size_t n, F f) { //f(desde, hasta, tarea) sobre [0, n); devuelve cuantas tareas hubo
+        if (!paralelo) { f(0, n, 0); return 1; }
+        size_t porTarea = (n + MAX_TAREAS - 1) / MAX_TAREAS;
+        if (porTarea == 0) porTarea = 1;
+        jobs->parallelFor(n, porTarea, f);
+        return (n + porTarea - 1) / porTarea;
+    }
+    CommandBuffer comandos;
+
+    void destruirAsteroide(unsigned i) { //queda inactivo ya (las colisiones lo ignoran) y se borra al final
+        if (!asteroides.active[i]) return;
+        asteroides.active[i] = false;
+        comandos.destruirAsteroides.push_back(i);
+    }
+
+    void destruirBala(unsigned i) {
+        if (!balas.active[i]) return;
+        balas.active[i] = false;
+        comandos.destruirBalas.push_back(i);
+    }
+
+    void updateJugador(size_t j, float dt, const InputState& input) {
+        float& rotation = jugadores.rotation[j];
+        float& vx = jugadores.vx[j]; float& vy = jugadores.vy[j];
+        float& x = jugadores.x[j]; float& y = jugadores.y[j];
+        float acceleration = jugadores.acceleration[j], friction = jugadores.friction[j];
+
+        if (jugadores.invulnerabilityTime[j] > 0) //Para ser invulnerable al ser chocado
+            jugadores.invulnerabilityTime[j] -= dt;
+
+        if (input.left) {rotation -= 300.0f * dt;}
+        if (input.right) {rotation += 300.0f * dt;}
+        if (input.thrust) {
+            vx += cos(rotation * DEG2RAD) * acceleration * dt;
+            vy += sin(rotation * DEG2RAD) * acceleration * dt;
+        }
+        if (input.brake) {
+            vx -= cos(rotation * DEG2RAD) * acceleration * dt;
+            vy -= sin(rotation * DEG2RAD) * acceleration * dt;
+        }
+        if (input.shoot) {shoot(j);}
+
+        x += vx * dt; y += vy * dt; //actualizar posicion
+        vx *= friction; vy *= friction; //Disminuyendo velocidad por la friccion para proxima actualizacion
+        if (x > SCREEN_WIDTH) x = 0;
+        if (x < 0) x = SCREEN_WIDTH;
+        if (y > SCREEN_HEIGHT) y = 0;
+        if (y < 0) y = SCREEN_HEIGHT;
+    }
+
+    void updateBot(size_t j, float dt) {
+        float& rotation = jugadores.rotation[j];
+        float& vx = jugadores.vx[j]; float& vy = jugadores.vy[j];
+        float& x = jugadores.x[j]; float& y = jugadores.y[j];
+        float acceleration = jugadores.acceleration[j], friction = jugadores.friction[j];
+
+        if (jugadores.invulnerabilityTime[j] > 0)
+            jugadores.invulnerabilityTime[j] -= dt;
+        int target = -1;
+        float minDistance = 10000.0f;
+        float cx = x + PLAYER_SIZE/2, cy = y + PLAYER_SIZE/2;
+
+        //el asteroide con el centro mas cerca, preguntandole a la broadphase (antes se recorrian todos).
+        //Ojo: el recorrido viejo media de esquina a esquina (x, y de la nave contra x, y del asteroide) y
+        //nearest() mide de centro a centro, asi que con tamanios distintos el bot puede elegir otro blanco;
+        //por eso las grabaciones viejas no sirven (ver LOG_VERSION 7 en replay.h)
+        Vecino cercano;
+        if (broadphase->nearest(cx, cy, TIPO_ASTEROIDE, 1, &cercano) == 1) {
+            target = (int)cercano.ref.indice;
+            minDistance = sqrtf(cercano.dist2);
+        }
+        for (size_t i = primerAsteroideNuevo; i < asteroides.count(); i++) { //los que nacieron el tick pasado todavia no estan
+            float dist = sqrtf(Dist2Centro(asteroides.bounds(i), cx, cy));
+            if (dist < minDistance) { minDistance = dist; target = (int)i; }
+        } //Siempre elige el mas cercano
+
+        if (target != -1) {
+            float timeToHit = minDistance / BULLET_SPEED * parametrosBot.adelanto; //aproxima el tiempo en el que el disparo llegara con velocidad de la bala
+            float half = asteroides.w[target] / 2;
+            float fx = asteroides.x[target] + (asteroides.vx[target] * timeToHit) + half; //predice direcciones del asteroide
+            float fy = asteroides.y[target] + (asteroides.vy[target] * timeToHit) + half;
+            float desiredAngle = atan2(fy - (y+PLAYER_SIZE/2), fx - (x+PLAYER_SIZE/2)) * RAD2DEG; //obtiene el angulo deseado
+            if (desiredAngle < 0) desiredAngle += 360;
+
+            float diff = desiredAngle - rotation;
+            while (diff > 180) diff -= 360; //normaliza entre -180 y 180 para que no rote por el camino largo
+            while (diff < -180) diff += 360;
+
+            if (diff > 0) rotation += 300.0f * dt; else rotation -= 300.0f * dt; //rota hacia el angulo deseado
+
+            //si esta alineado a mas o menos conoDisparo grados con el punto predicho (o, con tiroEnLinea, ya hay
+            //un asteroide en la linea de tiro), dispara en probDisparo % de los frames (30 y 30 por defecto)
+            bool apunta = fabsf(diff) < parametrosBot.conoDisparo || (parametrosBot.tiroEnLinea && lineaDeTiro(cx, cy, rotation));
+            if (apunta && rng.entero(100) < parametrosBot.probDisparo) shoot(j);
+
+            if (minDistance < parametrosBot.radioEvasion) {
+                vx -= cos(desiredAngle * DEG2RAD) * acceleration * dt;
+                vy -= sin(desiredAngle * DEG2RAD) * acceleration * dt;
+            } else {
+                vx *= friction; vy *= friction;
+            }
+        }
+        x += vx * dt; y += vy * dt;
+        if (x > SCREEN_WIDTH) x = 0;
+        if (x < 0) x = SCREEN_WIDTH;
+        if (y > SCREEN_HEIGHT) y = 0;
+        if (y < 0) y = SCREEN_HEIGHT;
+    }
+
+    bool lineaDeTiro(float cx, float cy, float rotation) { //rayo hasta donde llega una bala antes de expirar
+        float dx = cosf(rotation * DEG2RAD), dy = sinf(rotation * DEG2RAD), alcance = BULLET_SPEED * BULLET_LIFETIME;
+        Impacto hit;
+        if (broadphase->raycast(cx, cy, dx, dy, alcance, TIPO_ASTEROIDE, hit)) return true;
+        float t;
+        for (size_t i = primerAsteroideNuevo; i < asteroides.count(); i++) { //igual que en updateBot
+            if (RayoCaja(cx, cy, 1.0f / dx, 1.0f / dy, asteroides.bounds(i), alcance, t)) return true;
+        }
+        return false;
+    }
+
+    void updateAsteroides(float dt) { //integra y envuelve de a 4/8 (ver simd.h); salen enteros por el borde antes de aparecer del otro lado
+        repartir(asteroides.count(), [&](size_t d, size_t h, size_t) {
+            IntegrarEnvolver(asteroides.x.data() + d, asteroides.vx.data() + d, asteroides.w.data() + d, 0, SCREEN_WIDTH, h - d, dt);
+            IntegrarEnvolver(asteroides.y.data() + d, asteroides.vy.data() + d, asteroides.w.data() + d, 0, SCREEN_HEIGHT, h - d, dt);
+        });
+    }
+
+    void updateBalas(float dt) {
+        size_t tareas = repartir(balas.count(), [&](size_t d, size_t h, size_t t) {
+            memcpy(balas.x0.data() + d, balas.x.data() + d, (h - d) * sizeof(float)); //comienzo del barrido
+            memcpy(balas.y0.data() + d, balas.y.data() + d, (h - d) * sizeof(float));
+            IntegrarEnvolver(balas.x.data() + d, balas.vx.data() + d, nullptr, 0, SCREEN_WIDTH, h - d, dt); //para que no desaparezca de la pantalla
+            IntegrarEnvolver(balas.y.data() + d, balas.vy.data() + d, nullptr, 0, SCREEN_HEIGHT, h - d, dt);
+            MiVector<unsigned>& expiradas = expiradasPorTarea[t];
+            expiradas.clear();
+            for (size_t i = d; i < h; i++) {
+                balas.lifeTime[i] -= dt;
+                if (balas.lifeTime[i] <= 0) expiradas.push_back((unsigned)i);
+            }
+        });
+        for (size_t t = 0; t < tareas; t++) { //para borrar (en orden de indice, como si fuera un solo hilo)
+            for (size_t k = 0; k < expiradasPorTarea[t].size(); k++) destruirBala(expiradasPorTarea[t][k]);
+        }
+    }
+
+    //La estructura no se reconstruye desde World: cada entidad mueve su proxy y el backend decide
+    //(el quadtree solo reinserta las que cambiaron de nodo). Las que nacieron en el tick anterior (proxy == -1) se insertan aqui.
+    void sincronizarBroadphase() {
+        broadphase->resetContadores();
+        for (size_t j = 0; j < jugadores.count(); j++) {
+            if (jugadores.proxy[j] == -1) jugadores.proxy[j] = broadphase->insert({ jugadores.bounds(j), { TIPO_JUGADOR, (unsigned)j } });
+            else broadphase->move(jugadores.proxy[j], jugadores.bounds(j));
+        }
+        for (size_t i = 0; i < asteroides.count(); i++) sincronizarProxy(asteroides.proxy[i], asteroides.active[i], asteroides.bounds(i), { TIPO_ASTEROIDE, (unsigned)i });
+        //la bala entra con todo su recorrido del paso, agrandado lo que puede moverse un asteroide: asi
+        //cualquier asteroide que la cruce durante el paso sale como candidato aunque al final ya no se toquen
+        float margen = ASTEROIDE_VEL_MAX * dtPaso;
+        for (size_t i = 0; i < balas.count(); i++) sincronizarProxy(balas.proxy[i], balas.active[i], balas.barrido(i, dtPaso, margen), { TIPO_BALA, (unsigned)i });
+        primerAsteroideNuevo = asteroides.count();
+    }
+
+    void sincronizarProxy(int& proxy, bool active, const Rect& r, EntityRef ref) {
+        if (!active) { //las balas que expiraron en el update salen de la broadphase ya
+            if (proxy != -1) { broadphase->remove(proxy); proxy = -1; }
+        } else if (proxy == -1) {
+            proxy = broadphase->insert({ r, ref });
+        } else {
+            broadphase->move(proxy, r);
+        }
+    }
+
+    //Bajas con swap-and-pop: se procesan de mayor a menor indice, asi el ultimo que se mueve al hueco
+    //nunca es uno que tambien habia que borrar. Costo O(k log k) para k bajas, sin correr el resto.
+    void aplicarComandos() {
+        MiVector<unsigned>& muertasB = comandos.destruirBalas;
+        std::sort(muertasB.begin(), muertasB.end(), [](unsigned a, unsigned b) { return a > b; });
+        for (size_t k = 0; k < muertasB.size(); k++) {
+            unsigned i = muertasB[k];
+            if (balas.proxy[i] != -1) broadphase->remove(balas.proxy[i]);
+            balas.swapPop(i);
+            if (i < balas.count() && balas.proxy[i] != -1) broadphase->setRef(balas.proxy[i], { TIPO_BALA, i }); //el que se movio al hueco
+        }
+
+        MiVector<unsigned>& muertosA = comandos.destruirAsteroides;
+        std::sort(muertosA.begin(), muertosA.end(), [](unsigned a, unsigned b) { return a > b; });
+        for (size_t k = 0; k < muertosA.size(); k++) {
+            unsigned i = muertosA[k];
+            if (asteroides.proxy[i] != -1) broadphase->remove(asteroides.proxy[i]);
+            asteroides.swapPop(i);
+            if (i < asteroides.count() && asteroides.proxy[i] != -1) broadphase->setRef(asteroides.proxy[i], { TIPO_ASTEROIDE, i });
+        }
+
+        //altas: entran sin proxy y se insertan en la broadphase en el proximo step
+        primerAsteroideNuevo = asteroides.count();
+        for (size_t k = 0; k < comandos.spawnAsteroides.size(); k++) {
+            const SpawnAsteroide& c = comandos.spawnAsteroides[k];
+            spawnAsteroid(c.x, c.y, c.sizeLevel);
+        }
+        for (size_t k = 0; k < comandos.spawnBalas.size(); k++) {
+            const SpawnBala& c = comandos.spawnBalas[k];
+            balas.push(c.x, c.y, c.vx, c.vy);
+        }
+        comandos.clear();
+    }
+
+    //Caja contra caja de los pares bala-asteroide de [desde, hasta): los pares seguidos de una misma
+    //bala van juntos a BarridoContraLote (hasta 8 asteroides por llamada), que prueba todo el paso y no
+    //solo la posicion final, asi una bala rapida no atraviesa un asteroide chico entre dos pasos.
+    //Devuelve cuantas pruebas hizo.
+    int probarCajas(size_t desde, size_t hasta) {
+        alignas(32) float lx[LOTE_AABB] = {}, ly[LOTE_AABB] = {}, lw[LOTE_AABB] = {};
+        alignas(32) float lmx[LOTE_AABB] = {}, lmy[LOTE_AABB] = {};
+        float dt = dtPaso;
+        int tests = 0;
+        for (size_t k = desde; k < hasta; ) {
+            if (pares[k].a.tipo != TIPO_BALA) { k++; continue; }
+            unsigned i = pares[k].a.indice;
+            int m = 0;
+            while (m < LOTE_AABB && k + m < hasta && pares[k + m].a.tipo == TIPO_BALA && pares[k + m].a.indice == i) {
+                unsigned a = pares[k + m].b.indice;
+                lx[m] = asteroides.x[a]; ly[m] = asteroides.y[a]; lw[m] = asteroides.w[a];
+                lmx[m] = asteroides.vx[a] * dt; lmy[m] = asteroides.vy[a] * dt;
+                m++;
+            }
+            unsigned mask = BarridoContraLote(balas.finalSinEnvolver(i, dt), balas.vx[i] * dt, balas.vy[i] * dt,
+                                              lx, ly, lw, lw, lmx, lmy, m); //los asteroides son cuadrados
+            for (int j = 0; j < m; j++) choques[k + j] = (mask >> j) & 1;
+            tests += m;
+            k += m;
+        }
+        return tests;
+    }
+
+    //Narrowphase en bloque sobre la lista compacta de pares que arma la broadphase
+    //(cada par bala-asteroide o jugador-asteroide llega una sola vez).
+    //Primero se prueban todas las cajas (en paralelo si corresponde) y despues se aplican los
+    //choques en el orden de la lista.
+    //Con maxPares la lista de pares tiene tope: si la escena da maxPares o mas, el step queda marcado en
+    //paresExcedidos y no se aplica ningun choque. En paralelo cada tarea tiene maxPares / MAX_TAREAS; si
+    //alguna se llena se vuelve a enumerar en un solo hilo con el tope entero, asi la memoria no pasa de
+    //maxPares y el veredicto depende solo de la escena, no de cuantos hilos hay.
+    void colisiones() {
+        pares.clear();
+        bool enUnHilo = !paralelo;
+        if (paralelo) { //cada tarea enumera una parte de la broadphase y las listas se concatenan en orden
+            size_t parte = maxPares ? std::max<size_t>(maxPares / MAX_TAREAS, 1) : 0;
+            broadphase->setTopePares(parte);
+            broadphase->prepararPares();
+            size_t tareas = repartir(broadphase->tareasPares(), [&](size_t d, size_t h, size_t t) {
+                paresPorTarea[t].clear();
+                broadphase->paresTarea(d, h, paresPorTarea[t]);
+            });
+            for (size_t t = 0; t < tareas; t++) enUnHilo |= parte && paresPorTarea[t].size() >= parte;
+            if (!enUnHilo) {
+                for (size_t t = 0; t < tareas; t++) {
+                    for (size_t k = 0; k < paresPorTarea[t].size(); k++) pares.push_back(paresPorTarea[t][k]);
+                }
+                broadphase->contarCandidatos((int)pares.size());
+            }
+        }
+        if (enUnHilo) {
+            broadphase->setTopePares(maxPares);
+            broadphase->findPairs(pares);
+        }
+        paresExcedidos = maxPares && pares.size() >= maxPares;
+        if (paresExcedidos) { pares.clear(); testsNarrowphase = 0; return; }
+        //Cada broadphase entrega los pares en un orden que depende de su historia (ids de proxy, nodos,
+        //altas y bajas); despues de restaurar una foto esa historia es otra. Ordenados por indice de
+        //entidad, una bala que toca dos asteroides en el mismo tick siempre se lleva el mismo.
+        std::sort(pares.begin(), pares.end(), MenorPar);
+
+        size_t total = pares.size();
+        choques.resize(total);
+        size_t tareas = repartir(total, [&](size_t d, size_t h, size_t t) { testsPorTarea[t] = probarCajas(d, h); });
+        testsNarrowphase = 0;
+        for (size_t t = 0; t < tareas; t++) testsNarrowphase += testsPorTarea[t];
+
+        for (size_t k = 0; k < total; k++) {
+            unsigned a = pares[k].b.indice; //siempre es un asteroide
+            if (!asteroides.active[a]) continue;
+            unsigned i = pares[k].a.indice;
+
+            if (pares[k].a.tipo == TIPO_JUGADOR) { //Para detectar veces que perdiste
+                if (jugadores.invulnerabilityTime[i] > 0) continue;
+                testsNarrowphase++;
+                if (jugadores.bounds(i).intersects(asteroides.bounds(a))) {
+                    vecesPerdidas++;
+                    jugadores.invulnerabilityTime[i] = 1.5f; // 1 segundo invulnerable
+                }
+                continue;
+            }
+
+            if (!balas.active[i]) continue; //una bala solo destruye un asteroide
+            if (!choques[k]) continue;
+            //EN CUANTOS SE DIVIDE LOS ASTEORIDES
+            destruirBala(i);
+            destruirAsteroide(a);
+            if (asteroides.sizeLevel[a] > 1) {
+                SpawnAsteroide hijo = { asteroides.x[a], asteroides.y[a], asteroides.sizeLevel[a] - 1 };
+                comandos.spawnAsteroides.push_back(hijo);
+                comandos.spawnAsteroides.push_back(hijo);
+            }
+        }
+    }
+};